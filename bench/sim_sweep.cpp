@@ -0,0 +1,196 @@
+// Encoder throughput sweep on the host simulator, for CI regression checks.
+//
+//   g++ -std=c++17 -O2 -march=native -Iinclude bench/sim_sweep.cpp -o sim_sweep
+//   ./sim_sweep > sweep.csv                 # record a baseline
+//   ./sim_sweep sweep.csv [tolerance%]      # fail on regressions against it
+//
+// For strip lengths from 100 to 100k pixels and each host-encodable format,
+// encodes a random frame and plays it through a TransmitEngine into a
+// SimBackend. The frame the simulated chain latches must equal the input.
+// Prints CSV: encode time per pixel, encode-bound and wire-bound frame
+// rates, and buffer bytes per pixel (RET padding included). Encode time is
+// the best of several samples taken in each of three passes over the whole
+// sweep, which keeps scheduler and frequency noise, even stalls lasting
+// seconds, out of the comparison. With a baseline, any row whose ns/pixel
+// grew by more than the tolerance (default 25%) fails the run, as does a
+// baseline that cannot be read or matches no row.
+#include <ws2812b/backends/sim.hpp>
+#include <ws2812b/bulk_encoder.hpp>
+#include <ws2812b/lut_encoder.hpp>
+#include <ws2812b/transmit_engine.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace ws2812b;
+
+struct Row {
+    std::string format;
+    std::size_t pixels;
+    double ns_per_pixel;
+    double wire_fps = 0;
+    double bytes_per_pixel = 0;
+    bool ok = true;
+};
+
+/// Timing passes over the sweep; each row keeps its fastest.
+constexpr int passes = 3;
+
+/// Best of `samples` timings of ~10ms each, in ns per call.
+template <typename Fn>
+double ns_per_call(Fn&& fn, int samples = 7)
+{
+    using clock = std::chrono::steady_clock;
+    const auto time = [&](std::size_t iterations) {
+        const auto start = clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            fn();
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    };
+    std::size_t iterations = 1;
+    while (time(iterations) < 1e7 && iterations < (std::size_t(1) << 20))
+        iterations *= 4;
+    double best = time(iterations);
+    for (int i = 1; i < samples; ++i) {
+        const double ns = time(iterations);
+        if (ns < best)
+            best = ns;
+    }
+    return best / double(iterations);
+}
+
+/// Encodes with `encode(pixels, out)`, times it, then sends one frame
+/// through the simulator and checks what the chain latched. Fills in
+/// rows[at], or keeps its faster time if an earlier pass already did.
+template <typename Format, typename Encode>
+bool sweep(const char* name, const std::vector<Grb>& grb, std::size_t pixels, Encode&& encode,
+           std::vector<Row>& rows, std::size_t& at)
+{
+    using Sim = SimBackend<Format>;
+    Sim sim(pixels);
+    TransmitEngine<Format, Sim> engine(sim, pixels);
+    auto frame = engine.acquire();
+    const double ns = ns_per_call([&] { encode(pixels, frame.data); });
+    engine.submit(frame, encoded_units<Format>(pixels));
+    const bool ok = sim.frames() == 1 && sim.chain().latches() == 1 && sim.chain().bad_bits() == 0 &&
+                    std::memcmp(sim.chain().latched(), grb.data(), pixels * sizeof(Grb)) == 0;
+
+    const double wire_s = double(sim.now_ps()) / 1e12;
+    const double bytes = double((encoded_units<Format>(pixels) + engine.reset_padding()) *
+                                sizeof(typename Format::unit_type));
+    if (at == rows.size())
+        rows.push_back(Row{name, pixels, ns / double(pixels), 1.0 / wire_s, bytes / double(pixels)});
+    Row& row = rows[at++];
+    if (ns / double(pixels) < row.ns_per_pixel)
+        row.ns_per_pixel = ns / double(pixels);
+    row.ok = row.ok && ok;
+    return ok;
+}
+
+/// Rows of a CSV written by an earlier run; false if it cannot be read.
+bool read_baseline(const char* path, std::vector<Row>& rows)
+{
+    std::FILE* f = std::fopen(path, "r");
+    if (!f) {
+        std::perror(path);
+        return false;
+    }
+    char line[256];
+    char name[64];
+    while (std::fgets(line, sizeof line, f)) {
+        std::size_t pixels = 0;
+        double ns = 0;
+        if (std::sscanf(line, "%63[^,],%zu,%lf", name, &pixels, &ns) == 3)
+            rows.push_back(Row{name, pixels, ns});
+    }
+    const bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const double tolerance = argc > 2 ? std::strtod(argv[2], nullptr) : 25.0;
+    std::vector<Row> baseline;
+    if (argc > 1 && !read_baseline(argv[1], baseline))
+        return 1;
+    const std::size_t lengths[] = {100, 300, 1000, 3000, 10000, 30000, 100000};
+    const std::size_t longest = lengths[sizeof lengths / sizeof lengths[0] - 1];
+
+    std::mt19937 rng(2812);
+    std::vector<Grb> grb(longest);
+    for (auto& p : grb)
+        p = Grb{std::uint8_t(rng()), std::uint8_t(rng()), std::uint8_t(rng())};
+    std::vector<std::uint8_t> rgb;
+    for (const auto& p : grb)
+        rgb.insert(rgb.end(), {p.r, p.g, p.b});
+
+    using Pwm = PwmWords<72'000'000>;
+    using Rmt = RmtItems<>;
+    std::vector<Row> rows;
+    bool ok = true;
+    for (int pass = 0; pass < passes; ++pass) {
+        std::size_t at = 0;
+        for (std::size_t n : lengths) {
+            ok &= sweep<Spi3>("spi3", grb, n,
+                              [&](std::size_t m, std::uint8_t* out) {
+                                  encode_pixels<Spi3>(grb.data(), m, out);
+                              },
+                              rows, at);
+            ok &= sweep<Spi4>("spi4", grb, n,
+                              [&](std::size_t m, std::uint8_t* out) {
+                                  encode_frame<Spi4>(rgb.data(), m, PixelLayout::rgb, out);
+                              },
+                              rows, at);
+            ok &= sweep<Pwm>("pwm72", grb, n,
+                             [&](std::size_t m, std::uint16_t* out) {
+                                 encode_pixels<Pwm>(grb.data(), m, out);
+                             },
+                             rows, at);
+            ok &= sweep<Rmt>("rmt40", grb, n,
+                             [&](std::size_t m, std::uint32_t* out) {
+                                 encode_pixels<Rmt>(grb.data(), m, out);
+                             },
+                             rows, at);
+            ok &= sweep<PioBytes>("pio", grb, n,
+                                  [&](std::size_t m, std::uint8_t* out) {
+                                      encode_pixels<PioBytes>(grb.data(), m, out);
+                                  },
+                                  rows, at);
+        }
+    }
+
+    std::printf("format,pixels,encode_ns_per_pixel,encode_fps,wire_fps,bytes_per_pixel,chain\n");
+    for (const Row& r : rows)
+        std::printf("%s,%zu,%.3f,%.0f,%.2f,%.2f,%s\n", r.format.c_str(), r.pixels, r.ns_per_pixel,
+                    1e9 / (r.ns_per_pixel * double(r.pixels)), r.wire_fps, r.bytes_per_pixel,
+                    r.ok ? "ok" : "FAIL");
+
+    if (argc > 1) {
+        std::size_t matched = 0;
+        for (const Row& base : baseline)
+            for (const Row& r : rows)
+                if (r.format == base.format && r.pixels == base.pixels) {
+                    ++matched;
+                    if (r.ns_per_pixel > base.ns_per_pixel * (1.0 + tolerance / 100.0)) {
+                        std::fprintf(stderr, "regression: %s %zu pixels %.3f -> %.3f ns/pixel\n",
+                                     r.format.c_str(), r.pixels, base.ns_per_pixel, r.ns_per_pixel);
+                        ok = false;
+                    }
+                }
+        if (matched == 0) {
+            std::fprintf(stderr, "%s: no rows match this run\n", argv[1]);
+            return 1;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Timing compliance and throughput benchmark.
+//
+//   g++ -std=c++17 -O2 -march=native -Iinclude bench/timing_compliance.cpp -o timing_compliance
+//   ./timing_compliance [pixels] [capture.csv]
+//
+// Without a capture, every symbol format is encoded, rendered into the
+// waveform its peripheral would produce and checked against the datasheet
+// windows. With a capture (two columns, time in seconds and line level, as
+// exported by common logic analyzers), the captured waveform is checked
+// instead. Prints width histograms (p50/p99/max), violation counts,
+// encode CPU time per frame and the resulting frame rates.
+#include <ws2812b/bulk_encoder.hpp>
+#include <ws2812b/compliance.hpp>
+#include <ws2812b/lut_encoder.hpp>
+#include <ws2812b/parallel_output.hpp>
+#include <ws2812b/power_limit.hpp>
+#include <ws2812b/timing_profile.hpp>
+#include <ws2812b/waveform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace ws2812b;
+
+void print_histogram(const char* name, const Histogram& h)
+{
+    if (h.count() == 0)
+        return;
+    std::printf("  %-6s n=%-9llu min=%-6llu p50=%-6llu p99=%-6llu max=%llu ns\n", name,
+                (unsigned long long)h.count(), (unsigned long long)h.min(),
+                (unsigned long long)h.percentile(0.50), (unsigned long long)h.percentile(0.99),
+                (unsigned long long)h.max());
+}
+
+void print_report(const ComplianceChecker& c)
+{
+    print_histogram("T0H", c.t0h);
+    print_histogram("T0L", c.t0l);
+    print_histogram("T1H", c.t1h);
+    print_histogram("T1L", c.t1l);
+    print_histogram("RET", c.reset);
+    std::printf("  bits=%llu frames=%llu bad_high=%llu bad_low=%llu gaps=%llu partial=%llu -> %s\n",
+                (unsigned long long)c.bits, (unsigned long long)c.frames,
+                (unsigned long long)c.bad_high, (unsigned long long)c.bad_low,
+                (unsigned long long)c.gaps, (unsigned long long)c.partial_frames,
+                c.violations() == 0 ? "PASS" : "FAIL");
+}
+
+template <typename Fn>
+double ns_per_call(Fn&& fn)
+{
+    using clock = std::chrono::steady_clock;
+    std::size_t iterations = 1;
+    for (;;) {
+        const auto start = clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            fn();
+        const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if (ns > 2e8 || iterations > (std::size_t(1) << 24))
+            return ns / double(iterations);
+        iterations *= 4;
+    }
+}
+
+template <typename Format, typename Encode>
+bool run_format(const char* name, std::size_t pixels, Encode&& encode, std::size_t units,
+                unsigned channel = 0)
+{
+    std::vector<typename Format::unit_type> buf(units + reset_units<Format>());
+    encode(buf.data());
+    encode_idle<Format>(reset_units<Format>(), buf.data() + units);
+    const double cpu_ns = ns_per_call([&] { encode(buf.data()); });
+
+    ComplianceChecker check;
+    const std::uint64_t wire_ps = render_waveform<Format>(buf.data(), buf.size(), check, channel);
+
+    std::printf("%s: %zu pixels, encode %.0f ns/frame (%.2f ns/pixel, %.0f frames/s CPU),"
+                " wire %.1f us/frame (%.1f frames/s)\n",
+                name, pixels, cpu_ns, cpu_ns / double(pixels), 1e9 / cpu_ns,
+                double(wire_ps) / 1e6, 1e12 / double(wire_ps));
+    print_report(check);
+    return check.violations() == 0;
+}
+
+/// PIO frames carry no RET padding; the backend pauses instead.
+bool run_pio(std::size_t pixels, const std::vector<Grb>& grb)
+{
+    std::vector<std::uint8_t> buf(encoded_units<PioBytes>(pixels));
+    const double cpu_ns =
+        ns_per_call([&] { encode_pixels<PioBytes>(grb.data(), pixels, buf.data()); });
+    ComplianceChecker check;
+    std::uint64_t wire_ps = render_waveform<PioBytes>(buf.data(), buf.size(), check);
+    check(false, std::uint64_t(ws2812b_timing.reset_ns) * 1000);
+    wire_ps += std::uint64_t(ws2812b_timing.reset_ns) * 1000;
+    std::printf("pio 8MHz: %zu pixels, encode %.0f ns/frame, wire %.1f us/frame (%.1f frames/s)\n",
+                pixels, cpu_ns, double(wire_ps) / 1e6, 1e12 / double(wire_ps));
+    print_report(check);
+    return check.violations() == 0;
+}
+
+/// The power limiter with one zone over budget and one under, then with a
+/// black zone whose quiescent current alone is over budget, which must
+/// come out unscaled and unchanged: there is nothing to limit.
+bool run_power_limited(std::size_t pixels, const std::vector<std::uint8_t>& rgb)
+{
+    using Pwm = PwmWords<72'000'000>;
+    const PowerZone zones[] = {{pixels / 2, 500}, {pixels - pixels / 2, 100'000}};
+    PowerLimitedEncoder<Ws2812b, Pwm> limiter(zones, 2);
+    bool ok = run_format<Pwm>("pwm 72MHz power-limited", pixels,
+                              [&](std::uint16_t* out) {
+                                  limiter.encode(reinterpret_cast<const Rgb*>(rgb.data()), pixels, out);
+                              },
+                              encoded_units<Pwm>(pixels));
+
+    const PowerZone idle{pixels, std::uint32_t(pixels / 2)}; // 1mA per pixel idle
+    PowerLimitedEncoder<Ws2812b, Pwm> idle_limiter(&idle, 1);
+    std::vector<Rgb> black(pixels, Rgb{0, 0, 0});
+    std::vector<std::uint16_t> out(encoded_units<Pwm>(pixels)), plain(out.size());
+    idle_limiter.encode(black.data(), pixels, out.data());
+    encode_bytes<Pwm>(reinterpret_cast<const std::uint8_t*>(black.data()), pixels * 3, plain.data());
+    const bool idle_ok = idle_limiter.zone_scale(0) == idle_limiter.unscaled &&
+                         idle_limiter.limited() == 0 && out == plain;
+    std::printf("  idle zone over budget: scale %u, %u mA -> %s\n", idle_limiter.zone_scale(0),
+                idle_limiter.zone_ma(0), idle_ok ? "PASS" : "FAIL");
+    return ok && idle_ok;
+}
+
+bool check_capture(const char* path)
+{
+    std::FILE* f = std::fopen(path, "r");
+    if (!f) {
+        std::perror(path);
+        return false;
+    }
+    std::vector<Edge> edges;
+    char line[256];
+    while (std::fgets(line, sizeof line, f)) {
+        double t = 0;
+        int level = 0;
+        if (std::sscanf(line, "%lf,%d", &t, &level) == 2)
+            edges.push_back(Edge{std::uint64_t(t * 1e12 + 0.5), level != 0});
+    }
+    std::fclose(f);
+
+    ComplianceChecker check;
+    edges_to_runs(edges.data(), edges.size(), check, std::uint64_t(ws2812b_timing.reset_ns) * 1000);
+    std::printf("%s: %zu edges\n", path, edges.size());
+    print_report(check);
+    return check.violations() == 0;
+}
+
+/// The vector kernel against encode_bytes<Spi4>() of the same pixels in
+/// wire order, for both layouts and lengths whose tails take the scalar
+/// path. Source buffers are sized exactly, so an overread shows up under
+/// a sanitizer.
+bool check_bulk_kernel(std::mt19937& rng)
+{
+    static const std::size_t lengths[] = {1, 2, 3, 5, 15, 17, 31, 33, 47, 63, 65, 97, 1001};
+    std::size_t mismatches = 0;
+    for (PixelLayout layout : {PixelLayout::rgb, PixelLayout::rgba}) {
+        const std::size_t step = stride(layout);
+        for (std::size_t n : lengths) {
+            std::vector<std::uint8_t> src(n * step), wire(n * 3);
+            for (auto& b : src)
+                b = std::uint8_t(rng());
+            for (std::size_t i = 0; i < n; ++i) {
+                wire[3 * i + 0] = src[step * i + 1];
+                wire[3 * i + 1] = src[step * i + 0];
+                wire[3 * i + 2] = src[step * i + 2];
+            }
+            std::vector<std::uint8_t> out(encoded_units<Spi4>(n)), ref(out.size());
+            encode_frame<Spi4>(src.data(), n, layout, out.data());
+            encode_bytes<Spi4>(wire.data(), wire.size(), ref.data());
+            if (out != ref) {
+                std::printf("  %s, %zu pixels: differs from the scalar path\n",
+                            layout == PixelLayout::rgba ? "rgba" : "rgb", n);
+                ++mismatches;
+            }
+        }
+    }
+    std::printf("%s rgb/rgba vs scalar: %zu of %zu lengths differ  %s\n", bulk_kernel_name,
+                mismatches, 2 * (sizeof lengths / sizeof lengths[0]), mismatches == 0 ? "PASS" : "FAIL");
+    return mismatches == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::size_t pixels = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    if (argc > 2)
+        return check_capture(argv[2]) ? 0 : 1;
+
+    std::mt19937 rng(2812);
+    std::vector<Grb> grb(pixels);
+    std::vector<std::uint8_t> rgb(pixels * 3), rgba(pixels * 4);
+    for (auto& p : grb)
+        p = Grb{std::uint8_t(rng()), std::uint8_t(rng()), std::uint8_t(rng())};
+    for (auto& b : rgb)
+        b = std::uint8_t(rng());
+    for (auto& b : rgba)
+        b = std::uint8_t(rng());
+
+    bool ok = true;
+    ok &= run_format<Spi3>("spi3 lut", pixels,
+                           [&](std::uint8_t* out) { encode_pixels<Spi3>(grb.data(), pixels, out); },
+                           encoded_units<Spi3>(pixels));
+    ok &= run_format<Spi4>("spi4 lut", pixels,
+                           [&](std::uint8_t* out) { encode_pixels<Spi4>(grb.data(), pixels, out); },
+                           encoded_units<Spi4>(pixels));
+    using SpiFast = SolvedSpi<ws2812b_timing, 3, 250'000'000, 2>;
+    ok &= run_format<SpiFast>("spi3 solved 250MHz/92", pixels,
+                              [&](std::uint8_t* out) { encode_pixels<SpiFast>(grb.data(), pixels, out); },
+                              encoded_units<SpiFast>(pixels));
+    ok &= run_format<Spi4>(bulk_kernel_name, pixels,
+                           [&](std::uint8_t* out) {
+                               encode_frame<Spi4>(rgb.data(), pixels, PixelLayout::rgb, out);
+                           },
+                           encoded_units<Spi4>(pixels));
+    ok &= run_format<Spi4>((std::string(bulk_kernel_name) + " rgba").c_str(), pixels,
+                           [&](std::uint8_t* out) {
+                               encode_frame<Spi4>(rgba.data(), pixels, PixelLayout::rgba, out);
+                           },
+                           encoded_units<Spi4>(pixels));
+    ok &= check_bulk_kernel(rng);
+
+    using Pwm = PwmWords<72'000'000>;
+    ok &= run_format<Pwm>("pwm 72MHz", pixels,
+                          [&](std::uint16_t* out) { encode_pixels<Pwm>(grb.data(), pixels, out); },
+                          encoded_units<Pwm>(pixels));
+
+    using PwmFast = PwmWords<72'000'000, std::uint16_t, Ws2812bFast>;
+    ok &= run_format<PwmFast>("pwm 72MHz fast", pixels,
+                              [&](std::uint16_t* out) { encode_pixels<PwmFast>(grb.data(), pixels, out); },
+                              encoded_units<PwmFast>(pixels));
+
+    using Rmt = RmtItems<>;
+    ok &= run_format<Rmt>("rmt 40MHz", pixels,
+                          [&](std::uint32_t* out) { encode_pixels<Rmt>(grb.data(), pixels, out); },
+                          encoded_units<Rmt>(pixels));
+    ok &= run_pio(pixels, grb);
+
+    ok &= run_power_limited(pixels, rgb);
+
+    std::vector<Strip> strips(32, Strip{grb.data(), pixels});
+    strips[31].length = pixels / 2;
+    using Par = ParallelWords<std::uint32_t>;
+    for (unsigned channel : {0u, 31u})
+        ok &= run_format<Par>(channel == 0 ? "parallel x32 ch0" : "parallel x32 ch31", pixels,
+                              [&](std::uint32_t* out) {
+                                  encode_parallel<std::uint32_t>(strips.data(), strips.size(), out);
+                              },
+                              parallel_units<std::uint32_t>(pixels), channel);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// Bump arena for everything on the transmit path, carved out once at init.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace ws2812b {
+
+/// Accumulates the worst-case size of a sequence of arena allocations, so
+/// the arena can be sized exactly from strip length and channel count.
+class ArenaLayout {
+public:
+    template <typename T>
+    constexpr ArenaLayout& reserve(std::size_t n, std::size_t align = alignof(T)) noexcept
+    {
+        bytes_ += n * sizeof(T) + (align > 1 ? align - 1 : 0);
+        return *this;
+    }
+
+    constexpr ArenaLayout& add(const ArenaLayout& other) noexcept
+    {
+        bytes_ += other.bytes_;
+        return *this;
+    }
+
+    constexpr std::size_t bytes() const noexcept { return bytes_; }
+
+private:
+    std::size_t bytes_ = 0;
+};
+
+/// Monotonic allocator over one block of memory. Nothing is freed
+/// individually; the arena lives as long as the objects built from it.
+///
+/// Exhaustion throws std::bad_alloc, like the heap it replaces; it can only
+/// happen during initialization if the arena was sized with ArenaLayout.
+class Arena {
+public:
+    /// Uses caller-provided storage, e.g. a static or DMA-capable region.
+    Arena(void* storage, std::size_t bytes) noexcept
+        : base_(static_cast<std::uint8_t*>(storage)), size_(bytes) {}
+
+    /// Allocates the whole arena from the heap, once.
+    explicit Arena(std::size_t bytes)
+        : owned_(new std::uint8_t[bytes]), base_(owned_.get()), size_(bytes) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// Storage for `n` objects of `T`, value-initialized.
+    template <typename T>
+    T* allocate(std::size_t n, std::size_t align = alignof(T))
+    {
+        const std::uintptr_t at = reinterpret_cast<std::uintptr_t>(base_) + used_;
+        const std::size_t pad = (align - at % align) % align;
+        if (pad + n * sizeof(T) > size_ - used_)
+            throw std::bad_alloc();
+        T* p = reinterpret_cast<T*>(base_ + used_ + pad);
+        used_ += pad + n * sizeof(T);
+        for (std::size_t i = 0; i < n; ++i)
+            new (p + i) T();
+        return p;
+    }
+
+    std::size_t used() const noexcept { return used_; }
+    std::size_t capacity() const noexcept { return size_; }
+
+private:
+    std::unique_ptr<std::uint8_t[]> owned_;
+    std::uint8_t* base_;
+    std::size_t size_;
+    std::size_t used_ = 0;
+};
+
+/// Up to 32 equally sized blocks of `T` taken from an arena, lent out and
+/// returned without locks or heap calls. Any thread may acquire or release.
+template <typename T>
+class FramePool {
+public:
+    static constexpr std::size_t max_blocks = 32;
+
+    static constexpr ArenaLayout layout(std::size_t blocks, std::size_t block_size,
+                                        std::size_t align = alignof(T)) noexcept
+    {
+        return ArenaLayout{}.reserve<T>((blocks < max_blocks ? blocks : max_blocks) * block_size,
+                                        align);
+    }
+
+    FramePool(Arena& arena, std::size_t blocks, std::size_t block_size,
+              std::size_t align = alignof(T))
+        : blocks_(blocks < max_blocks ? blocks : max_blocks),
+          block_size_(block_size),
+          data_(arena.allocate<T>(blocks_ * block_size, align)),
+          free_(blocks_ == max_blocks ? ~std::uint32_t(0) : (std::uint32_t(1) << blocks_) - 1)
+    {
+    }
+
+    /// A free block of `block_size()` elements, or nullptr if all are out.
+    T* acquire() noexcept
+    {
+        std::uint32_t mask = free_.load(std::memory_order_relaxed);
+        while (mask != 0) {
+            const std::uint32_t bit = mask & (~mask + 1);
+            if (free_.compare_exchange_weak(mask, mask & ~bit, std::memory_order_acquire))
+                return data_ + index_of(bit) * block_size_;
+        }
+        return nullptr;
+    }
+
+    void release(T* block) noexcept
+    {
+        const std::size_t i = std::size_t(block - data_) / block_size_;
+        free_.fetch_or(std::uint32_t(1) << i, std::memory_order_release);
+    }
+
+    std::size_t block_size() const noexcept { return block_size_; }
+    std::size_t blocks() const noexcept { return blocks_; }
+
+private:
+    static std::size_t index_of(std::uint32_t bit) noexcept
+    {
+        std::size_t i = 0;
+        while (!(bit & 1u)) {
+            bit >>= 1;
+            ++i;
+        }
+        return i;
+    }
+
+    std::size_t blocks_;
+    std::size_t block_size_;
+    T* data_;
+    std::atomic<std::uint32_t> free_;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,328 @@
+// Versioned cache of artifacts that are slow to rebuild at boot.
+//
+// Pixel maps of large installations and per-channel reset calibration
+// take seconds to produce but depend only on the configuration (and the
+// hardware it names). The cache stores them as tagged sections in one
+// file, keyed by a hash of that configuration. At startup the file is
+// mapped and its header, section table and section checksums validated.
+// The sections are then used in place or copied out with a memcpy. Any
+// mismatch in magic, version, config hash or checksum makes open() fail,
+// and the caller rebuilds and rewrites the cache.
+//
+// Layout, little-endian: an ArtifactCacheHeader, the sections (each
+// 64-byte aligned), then `sections` ArtifactSection entries at
+// `table_offset`. The writer fills a temporary file and renames it over
+// the old cache, so power loss while writing leaves the previous cache.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ws2812b {
+
+struct ArtifactCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_bytes;
+    std::uint64_t config_hash;
+    std::uint32_t sections;
+    std::uint32_t reserved;
+    std::uint64_t table_offset;
+    std::uint64_t file_bytes;
+    std::uint64_t table_check; ///< fnv64 of the section table
+};
+
+struct ArtifactSection {
+    std::uint32_t tag;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+    std::uint64_t bytes;
+    std::uint64_t check; ///< fnv64 of the payload
+};
+
+static_assert(sizeof(ArtifactCacheHeader) == 56, "ArtifactCacheHeader layout is part of the file format");
+static_assert(sizeof(ArtifactSection) == 32, "ArtifactSection layout is part of the file format");
+
+inline constexpr char artifact_cache_magic[8] = {'W', 'S', '2', '8', '1', '2', 'A', 'C'};
+/// Bump when the layout of any cached artifact changes.
+inline constexpr std::uint32_t artifact_cache_version = 1;
+
+/// Section tag from four characters, e.g. artifact_tag("pmap").
+constexpr std::uint32_t artifact_tag(const char (&s)[5]) noexcept
+{
+    return std::uint32_t(std::uint8_t(s[0])) | std::uint32_t(std::uint8_t(s[1])) << 8 |
+           std::uint32_t(std::uint8_t(s[2])) << 16 | std::uint32_t(std::uint8_t(s[3])) << 24;
+}
+
+namespace detail {
+
+/// FNV-1a, 64 bits.
+inline std::uint64_t fnv64(const void* data, std::size_t n,
+                           std::uint64_t h = 14695981039346656037ull) noexcept
+{
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < n; ++i)
+        h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+} // namespace detail
+
+/// Hash of everything the cached artifacts are derived from: channel
+/// lengths, layout parameters, FormatIds, library version. Add values
+/// field by field; types with padding are rejected because their padding
+/// bytes would make the hash vary between runs.
+class ConfigHash {
+public:
+    ConfigHash() noexcept { add(artifact_cache_version); }
+
+    ConfigHash& add(const void* data, std::size_t bytes) noexcept
+    {
+        h_ = detail::fnv64(data, bytes, h_);
+        return *this;
+    }
+
+    template <typename T>
+    ConfigHash& add(const T& v) noexcept
+    {
+        static_assert(std::has_unique_object_representations_v<T>,
+                      "hash the fields of types with padding or floating point separately");
+        return add(static_cast<const void*>(&v), sizeof v);
+    }
+
+    template <typename T>
+    ConfigHash& add(const T* v, std::size_t count) noexcept
+    {
+        static_assert(std::has_unique_object_representations_v<T>,
+                      "hash the fields of types with padding or floating point separately");
+        return add(static_cast<const void*>(v), count * sizeof(T));
+    }
+
+    std::uint64_t value() const noexcept { return h_; }
+
+private:
+    std::uint64_t h_ = 14695981039346656037ull;
+};
+
+/// Writes a cache file section by section.
+class ArtifactCacheWriter {
+public:
+    ArtifactCacheWriter() = default;
+    ArtifactCacheWriter(const ArtifactCacheWriter&) = delete;
+    ArtifactCacheWriter& operator=(const ArtifactCacheWriter&) = delete;
+    ~ArtifactCacheWriter() { abandon(); }
+
+    /// Starts a cache for `config_hash` that replaces `path` on close().
+    bool open(const char* path, std::uint64_t config_hash)
+    {
+        abandon();
+        path_ = path;
+        tmp_ = path_ + ".tmp";
+        file_ = std::fopen(tmp_.c_str(), "wb");
+        if (!file_)
+            return false;
+        std::memset(&header_, 0, sizeof header_);
+        std::memcpy(header_.magic, artifact_cache_magic, sizeof header_.magic);
+        header_.version = artifact_cache_version;
+        header_.header_bytes = sizeof header_;
+        header_.config_hash = config_hash;
+        table_.clear();
+        return std::fwrite(&header_, sizeof header_, 1, file_) == 1;
+    }
+
+    /// Appends section `tag` holding `bytes` bytes of `data`.
+    bool add(std::uint32_t tag, const void* data, std::size_t bytes)
+    {
+        if (!file_ || !pad_to(round_up(std::uint64_t(std::ftell(file_)))))
+            return false;
+        const ArtifactSection s{tag, 0, std::uint64_t(std::ftell(file_)), bytes,
+                                detail::fnv64(data, bytes)};
+        if (bytes != 0 && std::fwrite(data, 1, bytes, file_) != bytes)
+            return false;
+        table_.push_back(s);
+        return true;
+    }
+
+    template <typename T>
+    bool add(std::uint32_t tag, const T* data, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "cached artifacts are copied as bytes");
+        return add(tag, static_cast<const void*>(data), count * sizeof(T));
+    }
+
+    /// Writes the section table, syncs the file and moves it into place.
+    bool close()
+    {
+        if (!file_)
+            return false;
+        bool ok = pad_to(round_up(std::uint64_t(std::ftell(file_))));
+        header_.sections = std::uint32_t(table_.size());
+        header_.table_offset = std::uint64_t(std::ftell(file_));
+        header_.table_check = detail::fnv64(table_.data(), table_.size() * sizeof(ArtifactSection));
+        header_.file_bytes = header_.table_offset + table_.size() * sizeof(ArtifactSection);
+        ok = ok && (table_.empty() ||
+                    std::fwrite(table_.data(), sizeof(ArtifactSection), table_.size(), file_) == table_.size());
+        ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 &&
+             std::fwrite(&header_, sizeof header_, 1, file_) == 1 && std::fflush(file_) == 0 &&
+             ::fsync(::fileno(file_)) == 0;
+        ok = std::fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        ok = ok && std::rename(tmp_.c_str(), path_.c_str()) == 0;
+        if (!ok)
+            std::remove(tmp_.c_str());
+        return ok;
+    }
+
+private:
+    static std::uint64_t round_up(std::uint64_t v) noexcept { return (v + 63) / 64 * 64; }
+
+    bool pad_to(std::uint64_t offset)
+    {
+        static const char zeros[64] = {};
+        const std::uint64_t pos = std::uint64_t(std::ftell(file_));
+        return offset == pos || std::fwrite(zeros, 1, std::size_t(offset - pos), file_) == offset - pos;
+    }
+
+    /// Drops an unfinished cache, leaving the old one in place.
+    void abandon() noexcept
+    {
+        if (!file_)
+            return;
+        std::fclose(file_);
+        file_ = nullptr;
+        std::remove(tmp_.c_str());
+    }
+
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    std::string tmp_;
+    ArtifactCacheHeader header_{};
+    std::vector<ArtifactSection> table_;
+};
+
+/// Read-only mapping of a cache file. Section pointers are 64-byte
+/// aligned and stay valid until close().
+class ArtifactCache {
+public:
+    ArtifactCache() = default;
+    ArtifactCache(const ArtifactCache&) = delete;
+    ArtifactCache& operator=(const ArtifactCache&) = delete;
+    ~ArtifactCache() { close(); }
+
+    /// Maps `path` and checks it was written for `config_hash`. `verify`
+    /// also checksums every section, which reads the whole file once.
+    /// Returns false, leaving the cache closed, for a missing, stale or
+    /// damaged file.
+    bool open(const char* path, std::uint64_t config_hash, bool verify = true)
+    {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        ArtifactCacheHeader h;
+        const bool ok = ::fstat(fd, &st) == 0 && std::size_t(st.st_size) >= sizeof h &&
+                        ::pread(fd, &h, sizeof h, 0) == ssize_t(sizeof h) &&
+                        std::memcmp(h.magic, artifact_cache_magic, sizeof h.magic) == 0 &&
+                        h.version == artifact_cache_version && h.header_bytes == sizeof h &&
+                        h.config_hash == config_hash && h.file_bytes == std::uint64_t(st.st_size) &&
+                        h.table_offset + std::uint64_t(h.sections) * sizeof(ArtifactSection) == h.file_bytes;
+        if (ok) {
+            void* p = ::mmap(nullptr, std::size_t(h.file_bytes), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                base_ = static_cast<const std::uint8_t*>(p);
+                bytes_ = std::size_t(h.file_bytes);
+            }
+        }
+        ::close(fd);
+        if (!base_)
+            return false;
+        header_ = h;
+        table_ = reinterpret_cast<const ArtifactSection*>(base_ + h.table_offset);
+        if (!valid(verify)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() noexcept
+    {
+        if (base_)
+            ::munmap(const_cast<std::uint8_t*>(base_), bytes_);
+        base_ = nullptr;
+        bytes_ = 0;
+        table_ = nullptr;
+        header_ = ArtifactCacheHeader{};
+    }
+
+    explicit operator bool() const noexcept { return base_ != nullptr; }
+
+    const ArtifactCacheHeader& header() const noexcept { return header_; }
+
+    /// Section `tag`, or nullptr if the cache has none; `bytes` receives its size.
+    const void* section(std::uint32_t tag, std::size_t* bytes = nullptr) const noexcept
+    {
+        for (std::uint32_t i = 0; i < header_.sections; ++i)
+            if (table_[i].tag == tag) {
+                if (bytes)
+                    *bytes = std::size_t(table_[i].bytes);
+                return base_ + table_[i].offset;
+            }
+        return nullptr;
+    }
+
+    /// Section `tag` as `count` values of `T`, or nullptr if it is missing
+    /// or has a different size.
+    template <typename T>
+    const T* get(std::uint32_t tag, std::size_t count) const noexcept
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "cached artifacts are copied as bytes");
+        std::size_t bytes = 0;
+        const void* p = section(tag, &bytes);
+        return p && bytes == count * sizeof(T) ? static_cast<const T*>(p) : nullptr;
+    }
+
+    /// Copies section `tag` into `out[count]`; false if it does not fit exactly.
+    template <typename T>
+    bool restore(std::uint32_t tag, T* out, std::size_t count) const noexcept
+    {
+        const T* p = get<T>(tag, count);
+        if (p && count != 0)
+            std::memcpy(static_cast<void*>(out), p, count * sizeof(T));
+        return p != nullptr;
+    }
+
+private:
+    bool valid(bool verify) const noexcept
+    {
+        if (detail::fnv64(table_, header_.sections * sizeof(ArtifactSection)) != header_.table_check)
+            return false;
+        for (std::uint32_t i = 0; i < header_.sections; ++i) {
+            const ArtifactSection& s = table_[i];
+            if (s.offset % 64 != 0 || s.offset < sizeof header_ || s.offset > header_.table_offset ||
+                s.bytes > header_.table_offset - s.offset)
+                return false;
+            if (verify && detail::fnv64(base_ + s.offset, std::size_t(s.bytes)) != s.check)
+                return false;
+        }
+        return true;
+    }
+
+    const std::uint8_t* base_ = nullptr;
+    std::size_t bytes_ = 0;
+    ArtifactCacheHeader header_{};
+    const ArtifactSection* table_ = nullptr;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,60 @@
+// What a hardware backend provides to TransmitEngine.
+//
+// A backend drives one peripheral. It declares:
+//
+//     using format_type = ...;              // symbols the peripheral consumes
+//     static constexpr std::size_t buffer_alignment = ...;   // bytes, for DMA
+//     void set_completion(void (*fn)(void*), void* ctx) noexcept;
+//     void start(const format_type::unit_type* data, std::size_t units) noexcept;
+//
+// start() begins a non-blocking transfer from `data`. On the MCU backends
+// the peripheral's DMA reads the engine's buffer directly; spidev copies it
+// into the kernel's bounce buffer chunk by chunk. Once the last unit is out
+// and, for formats without RET padding, the reset gap has elapsed, the
+// backend calls `fn(ctx)`, typically from interrupt context. TransmitEngine
+// registers itself through set_completion() and allocates its buffers with
+// buffer_alignment.
+//
+// Backends for the supported peripherals live in backends/:
+//
+//     spidev.hpp       Linux spidev (Raspberry Pi SPI), Spi3/Spi4
+//     esp32_rmt.hpp    ESP32 RMT, RmtItems
+//     rp2040_pio.hpp   RP2040 PIO + DMA, PioBytes
+//     stm32_pwm.hpp    STM32 timer PWM + DMA (HAL), PwmWords; at most
+//                      65535 words per frame, longer chains stream
+//     sim.hpp          host simulator with a cascade model, any format
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+namespace ws2812b {
+
+using completion_fn = void (*)(void* ctx);
+
+namespace detail {
+
+template <typename B, typename = void>
+struct backend_alignment : std::integral_constant<std::size_t, 0> {};
+template <typename B>
+struct backend_alignment<B, std::void_t<decltype(B::buffer_alignment)>>
+    : std::integral_constant<std::size_t, B::buffer_alignment> {};
+
+template <typename B, typename = void>
+struct has_completion_hook : std::false_type {};
+template <typename B>
+struct has_completion_hook<B, std::void_t<decltype(std::declval<B&>().set_completion(
+                                  std::declval<completion_fn>(), std::declval<void*>()))>>
+    : std::true_type {};
+
+} // namespace detail
+
+/// Buffer alignment a backend asks for, at least that of `Unit`.
+template <typename Backend, typename Unit>
+constexpr std::size_t buffer_alignment() noexcept
+{
+    constexpr std::size_t wanted = detail::backend_alignment<Backend>::value;
+    return wanted > alignof(Unit) ? wanted : alignof(Unit);
+}
+
+} // namespace ws2812b
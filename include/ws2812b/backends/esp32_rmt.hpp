@@ -0,0 +1,129 @@
+// ESP32 RMT backend (ESP-IDF legacy RMT driver, driver/rmt.h).
+//
+// The RMT driver refills the channel's RAM from the engine's item buffer
+// in its interrupt, so items are read in place. Buffers end with low items
+// covering RET (see RmtItems), so the driver's tx-end event is the latch
+// boundary. The driver has a single tx-end callback for all channels; the
+// backend installs it and dispatches by channel.
+//
+// The tx-end callback runs in the RMT interrupt, where rmt_write_items()
+// (it takes the channel's tx semaphore) must not be called. The callback
+// therefore only notifies a small task per backend, and the task reports
+// completion, so the engine starts its next queued frame in task context.
+// The task's priority bounds how late that start can be, which adds to the
+// low time after the frame's RET padding.
+#pragma once
+
+#include "../symbol_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <driver/rmt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace ws2812b {
+
+template <typename Format = RmtItems<>>
+class Esp32RmtBackend {
+    static_assert(detail::is_rmt_format<Format>::value, "RMT needs RmtItems");
+    static_assert(Format::rmt_tick_hz == 40'000'000, "open() configures clk_div 2 of the 80 MHz APB clock");
+
+public:
+    using format_type = Format;
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t buffer_alignment = 4;
+
+    Esp32RmtBackend() = default;
+    Esp32RmtBackend(const Esp32RmtBackend&) = delete;
+    Esp32RmtBackend& operator=(const Esp32RmtBackend&) = delete;
+    ~Esp32RmtBackend() { close(); }
+
+    /// Configures `channel` to drive `gpio` and installs the driver.
+    /// `mem_blocks` RMT RAM blocks (64 items each) trade channels for
+    /// fewer refill interrupts. `task_priority` is that of the completion
+    /// task; run it above the renderer.
+    bool open(rmt_channel_t channel, gpio_num_t gpio, std::uint8_t mem_blocks = 1,
+              UBaseType_t task_priority = configMAX_PRIORITIES - 2)
+    {
+        rmt_config_t cfg = RMT_DEFAULT_CONFIG_TX(gpio, channel);
+        cfg.clk_div = 2;
+        cfg.mem_block_num = mem_blocks;
+        cfg.tx_config.loop_en = false;
+        cfg.tx_config.carrier_en = false;
+        cfg.tx_config.idle_output_en = true;
+        cfg.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+        if (rmt_config(&cfg) != ESP_OK || rmt_driver_install(channel, 0, 0) != ESP_OK)
+            return false;
+        if (xTaskCreate(&Esp32RmtBackend::completion_task, "ws2812b_rmt", 2048, this, task_priority,
+                        &task_) != pdPASS) {
+            rmt_driver_uninstall(channel);
+            return false;
+        }
+        channel_ = channel;
+        instances()[channel] = this;
+        rmt_register_tx_end_callback(&Esp32RmtBackend::tx_end, nullptr);
+        open_ = true;
+        return true;
+    }
+
+    void close()
+    {
+        if (!open_)
+            return;
+        instances()[channel_] = nullptr;
+        rmt_driver_uninstall(channel_);
+        vTaskDelete(task_);
+        task_ = nullptr;
+        open_ = false;
+    }
+
+    void set_completion(void (*fn)(void*), void* ctx) noexcept
+    {
+        done_ = fn;
+        ctx_ = ctx;
+    }
+
+    void start(const unit_type* data, std::size_t units) noexcept
+    {
+        rmt_write_items(channel_, reinterpret_cast<const rmt_item32_t*>(data), int(units), false);
+    }
+
+private:
+    static Esp32RmtBackend** instances() noexcept
+    {
+        static Esp32RmtBackend* table[RMT_CHANNEL_MAX] = {};
+        return table;
+    }
+
+    /// Interrupt context: hands completion to the task.
+    static void tx_end(rmt_channel_t channel, void*)
+    {
+        Esp32RmtBackend* self = instances()[channel];
+        if (!self)
+            return;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(self->task_, &woken);
+        if (woken == pdTRUE)
+            portYIELD_FROM_ISR();
+    }
+
+    static void completion_task(void* arg)
+    {
+        auto* self = static_cast<Esp32RmtBackend*>(arg);
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            if (self->done_)
+                self->done_(self->ctx_);
+        }
+    }
+
+    rmt_channel_t channel_ = RMT_CHANNEL_0;
+    bool open_ = false;
+    TaskHandle_t task_ = nullptr;
+    void (*done_)(void*) = nullptr;
+    void* ctx_ = nullptr;
+};
+
+} // namespace ws2812b
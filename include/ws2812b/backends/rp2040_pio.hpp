@@ -0,0 +1,140 @@
+// RP2040 PIO backend (pico-sdk): a state machine generates the waveform
+// from plain wire bytes fed to its TX FIFO by DMA.
+//
+// DMA reads the engine's buffer in place, one byte per FIFO write (byte
+// writes are replicated across the FIFO word, and the state machine
+// autopulls the top 8 bits). When the DMA completes, the FIFO and shift
+// register still hold up to 9 bytes; an alarm fires after they have drained
+// plus RET, which is when the engine is told the frame is latched.
+#pragma once
+
+#include "../symbol_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/pio.h>
+#include <pico/time.h>
+
+namespace ws2812b {
+
+class Rp2040PioBackend {
+public:
+    using format_type = PioBytes;
+    using unit_type = PioBytes::unit_type;
+    static constexpr std::size_t buffer_alignment = 4;
+
+    Rp2040PioBackend() = default;
+    Rp2040PioBackend(const Rp2040PioBackend&) = delete;
+    Rp2040PioBackend& operator=(const Rp2040PioBackend&) = delete;
+
+    /// Loads the program into `pio`, claims a state machine and a DMA
+    /// channel and drives `pin`. The DMA completion uses DMA_IRQ_0 with a
+    /// shared handler, so several backends can coexist.
+    bool open(PIO pio, unsigned pin, std::uint32_t reset_us = ws2812b_timing.reset_ns / 1000)
+    {
+        const int sm = pio_claim_unused_sm(pio, false);
+        if (sm < 0 || !pio_can_add_program(pio, &program))
+            return false;
+        const unsigned offset = pio_add_program(pio, &program);
+        pio_ = pio;
+        sm_ = unsigned(sm);
+        reset_us_ = reset_us;
+
+        pio_gpio_init(pio, pin);
+        pio_sm_set_consecutive_pindirs(pio, sm_, pin, 1, true);
+        pio_sm_config c = pio_get_default_sm_config();
+        sm_config_set_wrap(&c, offset + 0, offset + 3);
+        sm_config_set_sideset(&c, 1, false, false);
+        sm_config_set_sideset_pins(&c, pin);
+        sm_config_set_out_shift(&c, false, true, 8);
+        sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+        sm_config_set_clkdiv(&c, float(clock_get_hz(clk_sys)) / float(PioBytes::sm_clock_hz));
+        pio_sm_init(pio, sm_, offset, &c);
+        pio_sm_set_enabled(pio, sm_, true);
+
+        dma_ = unsigned(dma_claim_unused_channel(true));
+        dma_channel_config d = dma_channel_get_default_config(dma_);
+        channel_config_set_transfer_data_size(&d, DMA_SIZE_8);
+        channel_config_set_read_increment(&d, true);
+        channel_config_set_write_increment(&d, false);
+        channel_config_set_dreq(&d, pio_get_dreq(pio, sm_, true));
+        dma_channel_configure(dma_, &d, &pio->txf[sm_], nullptr, 0, false);
+
+        instances()[dma_] = this;
+        dma_channel_set_irq0_enabled(dma_, true);
+        static bool handler_installed = false;
+        if (!handler_installed) {
+            irq_add_shared_handler(DMA_IRQ_0, &Rp2040PioBackend::dma_irq,
+                                   PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(DMA_IRQ_0, true);
+            handler_installed = true;
+        }
+        return true;
+    }
+
+    void set_completion(void (*fn)(void*), void* ctx) noexcept
+    {
+        done_ = fn;
+        ctx_ = ctx;
+    }
+
+    /// Pause after each frame, e.g. a calibrated reset gap.
+    void set_reset_us(std::uint32_t reset_us) noexcept { reset_us_ = reset_us; }
+
+    void start(const unit_type* data, std::size_t units) noexcept
+    {
+        dma_channel_transfer_from_buffer_now(dma_, data, std::uint32_t(units));
+    }
+
+private:
+    // ws2812.pio with T1 = 3, T2 = 3, T3 = 4 cycles:
+    //   0: out x, 1        side 0 [3]
+    //   1: jmp !x, 3       side 1 [2]
+    //   2: jmp 0           side 1 [2]
+    //   3: nop             side 0 [2]
+    static constexpr std::uint16_t instructions[] = {0x6321, 0x1223, 0x1200, 0xa242};
+    static inline const pio_program_t program = {instructions, 4, -1};
+
+    /// Bytes that can still be queued after the DMA finished: 8 FIFO
+    /// entries plus the shift register.
+    static constexpr std::uint32_t drain_us =
+        std::uint32_t(9 * PioBytes::unit_ps / 1'000'000) + 1;
+
+    static Rp2040PioBackend** instances() noexcept
+    {
+        static Rp2040PioBackend* table[NUM_DMA_CHANNELS] = {};
+        return table;
+    }
+
+    static void dma_irq()
+    {
+        for (unsigned ch = 0; ch < NUM_DMA_CHANNELS; ++ch) {
+            Rp2040PioBackend* self = instances()[ch];
+            if (self && dma_channel_get_irq0_status(ch)) {
+                dma_channel_acknowledge_irq0(ch);
+                add_alarm_in_us(drain_us + self->reset_us_, &Rp2040PioBackend::latched, self, true);
+            }
+        }
+    }
+
+    static int64_t latched(alarm_id_t, void* user)
+    {
+        auto* self = static_cast<Rp2040PioBackend*>(user);
+        if (self->done_)
+            self->done_(self->ctx_);
+        return 0;
+    }
+
+    PIO pio_ = nullptr;
+    unsigned sm_ = 0;
+    unsigned dma_ = 0;
+    std::uint32_t reset_us_ = 50;
+    void (*done_)(void*) = nullptr;
+    void* ctx_ = nullptr;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,241 @@
+// Host simulator backend: the exact waveform of a format, run into a
+// model of the cascade, for tests and CI benchmarks without hardware.
+//
+// start() renders the symbols the engine hands it with render_waveform(),
+// on a virtual clock that starts at 0 and advances by each frame's wire
+// time. Every run goes to a ChainModel (the datasheet's decoder: each
+// pixel keeps the first 24 bits after a reset and forwards the rest, and
+// all latch on RET), and optionally to a packed edge list and a VCD file.
+// Completion is reported from inside start(), so on an engine with
+// several frames queued, start() and completion nest once per queued frame.
+#pragma once
+
+#include "../chip.hpp"
+#include "../symbol_format.hpp"
+#include "../waveform.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace ws2812b {
+
+/// The cascade as the datasheet describes it, fed with runs of the line.
+/// A high pulse is decoded at the midpoint between T0H and T1H. Bits past
+/// the last pixel come out of DOUT, and can be recorded as edges (re-timed
+/// to nominal widths, as a pixel regenerates them) for a LoopbackVerifier.
+class ChainModel {
+public:
+    /// `latch_ns` is the low time the parts latch on; 0 means `t.reset_ns`.
+    /// Real parts often latch on much less, which is what calibrate_reset()
+    /// finds; setting it lower here models such a batch.
+    explicit ChainModel(std::size_t pixels, const Timing& t = ws2812b_timing,
+                        std::size_t pixel_bits = bits_per_pixel, std::uint32_t latch_ns = 0)
+        : pixels_(pixels), pixel_bits_(pixel_bits), timing_(t),
+          latch_ns_(latch_ns != 0 ? latch_ns : t.reset_ns),
+          incoming_(new std::uint8_t[pixels * pixel_bits / 8]()),
+          latched_(new std::uint8_t[pixels * pixel_bits / 8]())
+    {
+    }
+
+    /// One run of the line at `level` for `ps`.
+    void operator()(bool level, std::uint64_t ps)
+    {
+        const std::uint64_t ns = (ps + 500) / 1000;
+        const std::uint64_t start = now_ps_;
+        now_ps_ += ps;
+        if (!level) {
+            if (ns >= latch_ns_)
+                latch();
+            return;
+        }
+        const auto within = [&](std::uint32_t nominal) {
+            return ns + timing_.tolerance_ns >= nominal && ns <= nominal + timing_.tolerance_ns;
+        };
+        const bool one = ns >= (timing_.t0h_ns + timing_.t1h_ns) / 2;
+        if (!within(one ? timing_.t1h_ns : timing_.t0h_ns))
+            ++bad_bits_;
+        if (bit_ < pixels_ * pixel_bits_) {
+            std::uint8_t& byte = incoming_[bit_ / 8];
+            byte = std::uint8_t(byte << 1 | unsigned(one));
+        } else {
+            ++forwarded_;
+            if (dout_) {
+                dout_->push_back(Edge{start, true});
+                dout_->push_back(Edge{start + std::uint64_t(one ? timing_.t1h_ns : timing_.t0h_ns) * 1000, false});
+            }
+        }
+        ++bit_;
+    }
+
+    /// Appends the edges of every bit forwarded out of the last pixel to
+    /// `edges`, and an idle mark (a second low edge) at each latch that
+    /// followed forwarded bits; nullptr stops recording.
+    void record_dout(std::vector<Edge>* edges) noexcept { dout_ = edges; }
+
+    /// Wire-order bytes each pixel currently shows, pixel_bits/8 per pixel.
+    const std::uint8_t* latched() const noexcept { return latched_.get(); }
+    std::size_t pixels() const noexcept { return pixels_; }
+
+    /// RETs that latched at least one bit.
+    std::uint64_t latches() const noexcept { return latches_; }
+    /// Latches that ended inside a pixel, which keeps its previous value.
+    std::uint64_t partial_latches() const noexcept { return partial_; }
+    /// Highs outside both the T0H and the T1H window.
+    std::uint64_t bad_bits() const noexcept { return bad_bits_; }
+    /// Bits passed out of the last pixel.
+    std::uint64_t forwarded_bits() const noexcept { return forwarded_; }
+
+private:
+    void latch() noexcept
+    {
+        if (bit_ == 0)
+            return;
+        const std::size_t full = bit_ / pixel_bits_ < pixels_ ? bit_ / pixel_bits_ : pixels_;
+        std::memcpy(latched_.get(), incoming_.get(), full * pixel_bits_ / 8);
+        if (full < pixels_ && bit_ % pixel_bits_ != 0)
+            ++partial_;
+        if (dout_ && bit_ > pixels_ * pixel_bits_)
+            dout_->push_back(Edge{now_ps_, false});
+        ++latches_;
+        bit_ = 0;
+    }
+
+    const std::size_t pixels_;
+    const std::size_t pixel_bits_;
+    const Timing timing_;
+    const std::uint32_t latch_ns_;
+    std::unique_ptr<std::uint8_t[]> incoming_;
+    std::unique_ptr<std::uint8_t[]> latched_;
+    std::vector<Edge>* dout_ = nullptr;
+    std::uint64_t now_ps_ = 0;
+    std::uint64_t bit_ = 0;
+    std::uint64_t latches_ = 0;
+    std::uint64_t partial_ = 0;
+    std::uint64_t bad_bits_ = 0;
+    std::uint64_t forwarded_ = 0;
+};
+
+/// Value change dump of one wire, readable by GTKWave, PulseView and
+/// sigrok. Time is in ps from the first run.
+class VcdWriter {
+public:
+    VcdWriter() = default;
+    VcdWriter(const VcdWriter&) = delete;
+    VcdWriter& operator=(const VcdWriter&) = delete;
+    ~VcdWriter() { close(); }
+
+    bool open(const char* path, const char* signal = "din")
+    {
+        close();
+        file_ = std::fopen(path, "w");
+        if (!file_)
+            return false;
+        std::fprintf(file_, "$timescale 1ps $end\n$scope module ws2812b $end\n"
+                            "$var wire 1 ! %s $end\n$upscope $end\n$enddefinitions $end\n",
+                     signal);
+        started_ = false;
+        t_ps_ = 0;
+        return true;
+    }
+
+    /// One run of the line at `level` for `ps`.
+    void operator()(bool level, std::uint64_t ps)
+    {
+        if (file_ && (!started_ || level != level_))
+            std::fprintf(file_, "#%llu\n%c!\n", static_cast<unsigned long long>(t_ps_), level ? '1' : '0');
+        started_ = true;
+        level_ = level;
+        t_ps_ += ps;
+    }
+
+    bool close()
+    {
+        if (!file_)
+            return true;
+        std::fprintf(file_, "#%llu\n", static_cast<unsigned long long>(t_ps_));
+        const bool ok = std::fclose(file_) == 0;
+        file_ = nullptr;
+        return ok;
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+    bool started_ = false;
+    bool level_ = false;
+    std::uint64_t t_ps_ = 0;
+};
+
+/// Backend that plays frames into a ChainModel of `pixels` `ChipT` parts.
+/// `channel` picks the port bit of a ParallelWords stream.
+template <typename Format, typename ChipT = Ws2812b>
+class SimBackend {
+public:
+    using format_type = Format;
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t buffer_alignment = 64;
+
+    explicit SimBackend(std::size_t pixels, unsigned channel = 0, std::uint32_t latch_ns = 0)
+        : chain_(pixels, ChipT::timing, ChipT::bits_per_pixel, latch_ns), channel_(channel)
+    {
+    }
+
+    SimBackend(const SimBackend&) = delete;
+    SimBackend& operator=(const SimBackend&) = delete;
+
+    void set_completion(void (*fn)(void*), void* ctx) noexcept
+    {
+        done_ = fn;
+        ctx_ = ctx;
+    }
+
+    /// Also appends every edge of the line to `edges`; nullptr stops.
+    void record_edges(std::vector<Edge>* edges) noexcept { edges_ = edges; }
+    /// Also writes the line to `vcd`; nullptr stops.
+    void trace(VcdWriter* vcd) noexcept { vcd_ = vcd; }
+
+    void start(const unit_type* data, std::size_t units)
+    {
+        Sink sink{*this};
+        render_waveform<Format>(data, units, sink, channel_);
+        if constexpr (!detail::pads_reset<Format>::value)
+            sink(false, std::uint64_t(ChipT::timing.reset_ns) * 1000); // the backend's timed RET
+        ++frames_;
+        if (done_)
+            done_(ctx_);
+    }
+
+    ChainModel& chain() noexcept { return chain_; }
+    const ChainModel& chain() const noexcept { return chain_; }
+    /// Virtual time: the wire time of every frame played so far.
+    std::uint64_t now_ps() const noexcept { return now_ps_; }
+    std::uint64_t frames() const noexcept { return frames_; }
+
+private:
+    struct Sink {
+        SimBackend& b;
+        void operator()(bool level, std::uint64_t ps)
+        {
+            if (b.edges_)
+                b.edges_->push_back(Edge{b.now_ps_, level});
+            if (b.vcd_)
+                (*b.vcd_)(level, ps);
+            b.chain_(level, ps);
+            b.now_ps_ += ps;
+        }
+    };
+
+    ChainModel chain_;
+    const unsigned channel_;
+    std::vector<Edge>* edges_ = nullptr;
+    VcdWriter* vcd_ = nullptr;
+    void (*done_)(void*) = nullptr;
+    void* ctx_ = nullptr;
+    std::uint64_t now_ps_ = 0;
+    std::uint64_t frames_ = 0;
+};
+
+} // namespace ws2812b
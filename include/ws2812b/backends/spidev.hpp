@@ -0,0 +1,173 @@
+// Linux spidev backend (Raspberry Pi SPI0/SPI1 and similar).
+//
+// spidev copies each message from the engine's buffer into its own bounce
+// buffer of `bufsiz` bytes (a module parameter, 4096 by default; raise it
+// with spidev.bufsiz=65536 on the kernel command line) and rejects longer
+// messages. A frame is therefore sent as one ioctl per chunk of at most
+// `bufsiz` bytes. spidev ioctls block, so transfers run on a worker thread
+// that reports completion when the last chunk is done. Chunk boundaries can
+// add tens of microseconds of low time. Every symbol ends low, but a byte
+// need not end a symbol (eight 3-bit symbols span 3 bytes), so chunks are
+// cut on whole pixels: a multiple of chunk_bytes, which holds whole RGB and
+// RGBW pixels. The gap then stretches a low pulse but never a high one. A
+// gap longer than the parts' latch threshold would latch a partial frame,
+// so keep frames within one `bufsiz` where possible (see
+// bench/timing_compliance.cpp with a capture to measure the gap on a given
+// board).
+#pragma once
+
+#include "../symbol_format.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace ws2812b {
+
+template <typename Format = Spi4>
+class SpidevBackend {
+    static_assert(detail::is_spi_format<Format>::value, "spidev needs an SPI symbol format");
+
+public:
+    using format_type = Format;
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t buffer_alignment = 64;
+    /// Bytes of 12 data bytes, four RGB or three RGBW pixels; every chunk
+    /// but the last is a multiple of this.
+    static constexpr std::size_t chunk_bytes = 12 * Format::units_per_byte * sizeof(unit_type);
+    static_assert(chunk_bytes <= 4096, "spidev's default bufsiz must hold one chunk");
+
+    SpidevBackend() = default;
+    SpidevBackend(const SpidevBackend&) = delete;
+    SpidevBackend& operator=(const SpidevBackend&) = delete;
+    ~SpidevBackend() { close(); }
+
+    /// Opens e.g. "/dev/spidev0.0" at the format's clock. `bufsiz` must not
+    /// exceed the spidev module's buffer size; it bounds the longest message
+    /// sent, and must be at least chunk_bytes.
+    bool open(const char* device, std::size_t bufsiz = 4096)
+    {
+        close();
+        if (bufsiz < chunk_bytes)
+            return false;
+        fd_ = ::open(device, O_RDWR);
+        if (fd_ < 0)
+            return false;
+        std::uint8_t mode = SPI_MODE_0;
+        std::uint8_t bits = 8;
+        std::uint32_t hz = Format::spi_clock_hz;
+        if (::ioctl(fd_, SPI_IOC_WR_MODE, &mode) < 0 ||
+            ::ioctl(fd_, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+            ::ioctl(fd_, SPI_IOC_WR_MAX_SPEED_HZ, &hz) < 0) {
+            close();
+            return false;
+        }
+        bufsiz_ = bufsiz - bufsiz % chunk_bytes;
+        stop_ = false;
+        worker_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    void close()
+    {
+        if (worker_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_one();
+            worker_.join();
+        }
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+    void set_completion(void (*fn)(void*), void* ctx) noexcept
+    {
+        done_ = fn;
+        ctx_ = ctx;
+    }
+
+    void start(const unit_type* data, std::size_t units) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = data;
+            pending_units_ = units;
+        }
+        wake_.notify_one();
+    }
+
+    /// Transfers whose ioctl failed; the frame is reported complete anyway
+    /// so the engine keeps cycling.
+    std::uint32_t errors() const noexcept { return errors_.load(std::memory_order_relaxed); }
+
+private:
+    void run()
+    {
+        for (;;) {
+            const unit_type* data;
+            std::size_t units;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stop_ || pending_ != nullptr; });
+                if (stop_)
+                    return;
+                data = pending_;
+                units = pending_units_;
+                pending_ = nullptr;
+            }
+            transfer(data, units * sizeof(unit_type));
+            if (done_)
+                done_(ctx_);
+        }
+    }
+
+    void transfer(const unit_type* data, std::size_t bytes) noexcept
+    {
+        // spidev bounds the whole message, not each transfer in it, by
+        // bufsiz, so every chunk is a message of its own. bufsiz_ is a
+        // multiple of chunk_bytes, so each chunk ends on a pixel.
+        const auto* p = reinterpret_cast<const std::uint8_t*>(data);
+        while (bytes != 0) {
+            const std::size_t len = bytes < bufsiz_ ? bytes : bufsiz_;
+            spi_ioc_transfer chunk;
+            std::memset(&chunk, 0, sizeof chunk);
+            chunk.tx_buf = reinterpret_cast<std::uintptr_t>(p);
+            chunk.len = std::uint32_t(len);
+            chunk.speed_hz = Format::spi_clock_hz;
+            chunk.bits_per_word = 8;
+            if (::ioctl(fd_, SPI_IOC_MESSAGE(1), &chunk) < 0) {
+                errors_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            p += len;
+            bytes -= len;
+        }
+    }
+
+    int fd_ = -1;
+    std::size_t bufsiz_ = 4096 - 4096 % chunk_bytes;
+    void (*done_)(void*) = nullptr;
+    void* ctx_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread worker_;
+    bool stop_ = false;
+    const unit_type* pending_ = nullptr;
+    std::size_t pending_units_ = 0;
+    std::atomic<std::uint32_t> errors_{0};
+};
+
+} // namespace ws2812b
@@ -0,0 +1,120 @@
+// STM32 timer PWM + DMA backend (STM32Cube HAL).
+//
+// Include the family's HAL header (e.g. stm32f4xx_hal.h) first. The timer
+// is configured by the application with its counter clock at `TimerHz` of
+// the PwmWords format and ARR = period_ticks - 1; its DMA stream for the
+// channel's capture/compare request must be set to memory-to-peripheral,
+// memory increment, half-word on both sides. DMA then reloads CCR from the
+// engine's buffer at every update event. The trailing zero compare values
+// hold the line low for RET, after which the HAL reports the pulse train
+// finished; forward HAL_TIM_PWM_PulseFinishedCallback to on_pulse_finished().
+//
+// For start_stream() the DMA stream is set to circular mode instead, and
+// HAL_TIM_PWM_PulseFinishedHalfCpltCallback is forwarded to
+// on_pulse_half_finished() as well.
+//
+// One HAL DMA transfer moves at most 65535 words, RET padding included:
+// about 2700 pixels. start() rejects longer frames rather than cutting off
+// their tail and RET; drive longer chains through start_stream().
+#pragma once
+
+#include "../symbol_format.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef HAL_TIM_MODULE_ENABLED
+#error "include the STM32 HAL header with the TIM module enabled before stm32_pwm.hpp"
+#endif
+
+namespace ws2812b {
+
+template <typename Format>
+class Stm32PwmBackend {
+    static_assert(detail::is_pwm_format<Format>::value, "timer PWM needs PwmWords");
+    static_assert(sizeof(typename Format::unit_type) == 2, "DMA is configured for half-words");
+
+public:
+    using format_type = Format;
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t buffer_alignment = 4;
+    /// A HAL DMA transfer is at most 65535 words.
+    static constexpr std::size_t max_units = 0xFFFF;
+
+    Stm32PwmBackend(TIM_HandleTypeDef& timer, std::uint32_t channel) noexcept
+        : timer_(timer), channel_(channel) {}
+
+    void set_completion(void (*fn)(void*), void* ctx) noexcept
+    {
+        done_ = fn;
+        ctx_ = ctx;
+    }
+
+    void start(const unit_type* data, std::size_t units) noexcept
+    {
+        if (units > max_units) {
+            // Not sent; reported complete so the engine keeps cycling.
+            errors_.store(errors_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            stream_ = nullptr;
+            if (done_)
+                done_(ctx_);
+            return;
+        }
+        // Older HAL versions take a non-const pointer; the buffer is only read.
+        HAL_TIM_PWM_Start_DMA(&timer_, channel_,
+                              reinterpret_cast<std::uint32_t*>(const_cast<unit_type*>(data)),
+                              std::uint16_t(units));
+    }
+
+    /// Frames rejected for exceeding max_units.
+    std::uint32_t errors() const noexcept { return errors_.load(std::memory_order_relaxed); }
+
+    /// Plays a frame through a StreamingEncoder's ring; begin() must have
+    /// been called on it. Completion is signalled when it reports done.
+    template <typename Streamer>
+    void start_stream(Streamer& stream) noexcept
+    {
+        stream_ = &stream;
+        half_ = [](void* s) { return static_cast<Streamer*>(s)->on_half_transfer(); };
+        full_ = [](void* s) { return static_cast<Streamer*>(s)->on_transfer_complete(); };
+        start(stream.ring(), stream.ring_units());
+    }
+
+    /// Call from HAL_TIM_PWM_PulseFinishedHalfCpltCallback when streaming.
+    void on_pulse_half_finished(TIM_HandleTypeDef* htim) noexcept
+    {
+        if (htim == &timer_ && stream_ && half_(stream_))
+            finish();
+    }
+
+    /// Call from HAL_TIM_PWM_PulseFinishedCallback for every backend.
+    void on_pulse_finished(TIM_HandleTypeDef* htim) noexcept
+    {
+        if (htim != &timer_)
+            return;
+        if (stream_ && !full_(stream_))
+            return;
+        finish();
+    }
+
+private:
+    void finish() noexcept
+    {
+        HAL_TIM_PWM_Stop_DMA(&timer_, channel_);
+        stream_ = nullptr;
+        if (done_)
+            done_(ctx_);
+    }
+
+    TIM_HandleTypeDef& timer_;
+    std::uint32_t channel_;
+    void (*done_)(void*) = nullptr;
+    void* ctx_ = nullptr;
+    void* stream_ = nullptr;
+    bool (*half_)(void*) = nullptr;
+    bool (*full_)(void*) = nullptr;
+    std::atomic<std::uint32_t> errors_{0}; // written by start() only
+};
+
+} // namespace ws2812b
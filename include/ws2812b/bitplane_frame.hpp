@@ -0,0 +1,279 @@
+// Bit-plane framebuffer for parallel output.
+//
+// encode_parallel() transposes every pixel of every strip into port words
+// on each frame, and with 32 channels that transpose is about half of the
+// encode time. A BitPlaneFrame keeps the frame in the transposed form
+// instead: for each pixel, 24 words, one per wire bit, holding that bit of
+// every channel in bit `c`. Renderers draw into it with word-wide kernels
+// that act on a set of channels at once: fill, blit, blend and scale,
+// where blend and scale are bit-sliced arithmetic over all lanes. Encoding
+// then only interleaves the planes with the active and low slots.
+//
+// Pixels follow the wire order of Grb, as in encode_parallel(); apply
+// colour correction before set(), fill() or load().
+#pragma once
+
+#include "arena.hpp"
+#include "parallel_output.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ws2812b {
+
+template <typename Word>
+class BitPlaneFrame {
+public:
+    static constexpr std::size_t channels_max = ParallelWords<Word>::channels;
+    /// Words per pixel: one per wire bit.
+    static constexpr std::size_t planes_per_pixel = 24;
+
+    /// A black frame for `channels` strips (at most channels_max) of
+    /// `lengths[c]` pixels each.
+    BitPlaneFrame(const std::size_t* lengths, std::size_t channels)
+        : pixels_(longest(lengths, clamp(channels))),
+          owned_planes_(new Word[pixels_ * planes_per_pixel]),
+          owned_active_(new Word[pixels_])
+    {
+        planes_ = owned_planes_.get();
+        active_ = owned_active_.get();
+        init(lengths, clamp(channels));
+    }
+
+    BitPlaneFrame(Arena& arena, const std::size_t* lengths, std::size_t channels)
+        : pixels_(longest(lengths, clamp(channels))),
+          planes_(arena.allocate<Word>(pixels_ * planes_per_pixel, 64)),
+          active_(arena.allocate<Word>(pixels_))
+    {
+        init(lengths, clamp(channels));
+    }
+
+    static constexpr ArenaLayout layout(const std::size_t* lengths, std::size_t channels) noexcept
+    {
+        const std::size_t n = longest(lengths, clamp(channels));
+        return ArenaLayout{}.template reserve<Word>(n * planes_per_pixel, 64).template reserve<Word>(n);
+    }
+
+    BitPlaneFrame(const BitPlaneFrame&) = delete;
+    BitPlaneFrame& operator=(const BitPlaneFrame&) = delete;
+
+    /// Pixels of the longest strip.
+    std::size_t pixels() const noexcept { return pixels_; }
+    /// Channels that have a pixel `p`.
+    Word active(std::size_t p) const noexcept { return active_[p]; }
+    /// The 24 planes of pixel `p`, first wire bit first.
+    Word* planes(std::size_t p) noexcept { return planes_ + p * planes_per_pixel; }
+    const Word* planes(std::size_t p) const noexcept { return planes_ + p * planes_per_pixel; }
+
+    void clear() noexcept
+    {
+        for (std::size_t i = 0; i < pixels_ * planes_per_pixel; ++i)
+            planes_[i] = 0;
+    }
+
+    /// Pixel `p` of `channel`.
+    void set(std::size_t channel, std::size_t p, Grb c) noexcept
+    {
+        fill(Word(Word(1) << channel), p, 1, c);
+    }
+
+    Grb get(std::size_t channel, std::size_t p) const noexcept
+    {
+        std::uint8_t wire[3] = {};
+        const Word* src = planes(p);
+        for (std::size_t k = 0; k < planes_per_pixel; ++k)
+            wire[k / 8] = std::uint8_t(wire[k / 8] << 1 | ((src[k] >> channel) & 1u));
+        return Grb{wire[0], wire[1], wire[2]};
+    }
+
+    /// Sets pixels [first, first + n) of every channel in `mask` to `c`.
+    void fill(Word mask, std::size_t first, std::size_t n, Grb c) noexcept
+    {
+        const auto* wire = reinterpret_cast<const std::uint8_t*>(&c);
+        Word value[planes_per_pixel];
+        for (std::size_t k = 0; k < planes_per_pixel; ++k)
+            value[k] = (wire[k / 8] >> (7 - k % 8)) & 1u ? mask : Word(0);
+        for (std::size_t p = first; p < first + n; ++p) {
+            Word* dst = planes(p);
+            for (std::size_t k = 0; k < planes_per_pixel; ++k)
+                dst[k] = Word((dst[k] & ~mask) | value[k]);
+        }
+    }
+
+    /// Copies pixels [src_first, src_first + n) of `src` to [dst_first,
+    /// dst_first + n) here, on the channels in `mask`. Both frames must
+    /// hold those pixels; overlapping ranges of one frame are not allowed.
+    void blit(const BitPlaneFrame& src, std::size_t src_first, std::size_t dst_first, std::size_t n,
+              Word mask = Word(~Word(0))) noexcept
+    {
+        const Word* s = src.planes(src_first);
+        Word* d = planes(dst_first);
+        for (std::size_t i = 0; i < n * planes_per_pixel; ++i)
+            d[i] = Word((d[i] & ~mask) | (s[i] & mask));
+    }
+
+    /// Pixels [first, first + n) become (a * (256 - t) + b * t + 128) >> 8
+    /// per colour byte, on the channels in `mask`; `t` is 0 to 256. `a` or
+    /// `b` may be this frame, for in-place cross-fades.
+    void blend(const BitPlaneFrame& a, const BitPlaneFrame& b, unsigned t, std::size_t first,
+               std::size_t n, Word mask = Word(~Word(0))) noexcept
+    {
+        if (t > 256)
+            t = 256;
+        for (std::size_t p = first; p < first + n; ++p) {
+            const Word* pa = a.planes(p);
+            const Word* pb = b.planes(p);
+            Word* dst = planes(p);
+            for (std::size_t byte = 0; byte < 3; ++byte) {
+                Word x[8], y[8], acc[16];
+                lsb_first(pa + 8 * byte, x);
+                lsb_first(pb + 8 * byte, y);
+                start_rounding(acc);
+                for (unsigned j = 0; j < 9; ++j) {
+                    if ((256 - t) >> j & 1u)
+                        add_shifted(acc, x, j);
+                    if (t >> j & 1u)
+                        add_shifted(acc, y, j);
+                }
+                store(acc, dst + 8 * byte, mask);
+            }
+        }
+    }
+
+    /// Pixels [first, first + n) become (v * s + 128) >> 8 per colour byte,
+    /// on the channels in `mask`; `s` is 0 to 256.
+    void scale(unsigned s, std::size_t first, std::size_t n, Word mask = Word(~Word(0))) noexcept
+    {
+        if (s > 256)
+            s = 256;
+        for (std::size_t p = first; p < first + n; ++p) {
+            Word* dst = planes(p);
+            for (std::size_t byte = 0; byte < 3; ++byte) {
+                Word x[8], acc[16];
+                lsb_first(dst + 8 * byte, x);
+                start_rounding(acc);
+                for (unsigned j = 0; j < 9; ++j)
+                    if (s >> j & 1u)
+                        add_shifted(acc, x, j);
+                store(acc, dst + 8 * byte, mask);
+            }
+        }
+    }
+
+    /// Transposes `channels` strips into the frame, e.g. to load an image
+    /// or a background once. Pixels past a strip's end keep their value.
+    void load(const Strip* strips, std::size_t channels) noexcept
+    {
+        channels = clamp(channels);
+        for (std::size_t p = 0; p < pixels_; ++p) {
+            Word bits[planes_per_pixel];
+            const Word mask = detail::transpose_pixel(strips, channels, p, bits);
+            Word* dst = planes(p);
+            for (std::size_t k = 0; k < planes_per_pixel; ++k)
+                dst[k] = Word((dst[k] & ~mask) | bits[k]);
+        }
+    }
+
+private:
+    static constexpr std::size_t clamp(std::size_t channels) noexcept
+    {
+        return channels < channels_max ? channels : channels_max;
+    }
+
+    static constexpr std::size_t longest(const std::size_t* lengths, std::size_t channels) noexcept
+    {
+        std::size_t n = 0;
+        for (std::size_t c = 0; c < channels; ++c)
+            if (lengths[c] > n)
+                n = lengths[c];
+        return n;
+    }
+
+    void init(const std::size_t* lengths, std::size_t channels) noexcept
+    {
+        for (std::size_t p = 0; p < pixels_; ++p) {
+            Word a = 0;
+            for (std::size_t c = 0; c < channels; ++c)
+                if (p < lengths[c])
+                    a |= Word(Word(1) << c);
+            active_[p] = a;
+        }
+        clear();
+    }
+
+    // Bit-sliced arithmetic: word `i` of a number holds bit `i` of every lane.
+
+    /// Planes of one colour byte, which run MSB first, as bits LSB first.
+    static void lsb_first(const Word* planes, Word* bits) noexcept
+    {
+        for (std::size_t i = 0; i < 8; ++i)
+            bits[i] = planes[7 - i];
+    }
+
+    /// A 16-bit accumulator holding 128 in every lane, for rounding.
+    static void start_rounding(Word* acc) noexcept
+    {
+        for (std::size_t i = 0; i < 16; ++i)
+            acc[i] = i == 7 ? Word(~Word(0)) : Word(0);
+    }
+
+    /// acc += x << j in every lane, as a ripple-carry adder.
+    static void add_shifted(Word* acc, const Word* x, unsigned j) noexcept
+    {
+        Word carry = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            const Word sum = Word(acc[i + j] ^ x[i]);
+            const Word next = Word((acc[i + j] & x[i]) | (carry & sum));
+            acc[i + j] = Word(sum ^ carry);
+            carry = next;
+        }
+        for (unsigned i = j + 8; i < 16 && carry != 0; ++i) {
+            const Word next = Word(acc[i] & carry);
+            acc[i] = Word(acc[i] ^ carry);
+            carry = next;
+        }
+    }
+
+    /// Writes acc >> 8 back as the planes of one colour byte.
+    static void store(const Word* acc, Word* planes, Word mask) noexcept
+    {
+        for (std::size_t i = 0; i < 8; ++i)
+            planes[7 - i] = Word((planes[7 - i] & ~mask) | (acc[8 + i] & mask));
+    }
+
+    std::size_t pixels_;
+    std::unique_ptr<Word[]> owned_planes_;
+    std::unique_ptr<Word[]> owned_active_;
+    Word* planes_ = nullptr;
+    Word* active_ = nullptr;
+};
+
+/// Port words of pixels [first, last) of `frame` into `out`, which points
+/// at the words of pixel `first`; the same stream encode_parallel_range()
+/// makes from the equivalent strips. Disjoint ranges write disjoint words.
+template <typename Word>
+inline Word* encode_bitplanes_range(const BitPlaneFrame<Word>& frame, std::size_t first,
+                                    std::size_t last, Word* out) noexcept
+{
+    for (std::size_t p = first; p < last; ++p) {
+        const Word active = frame.active(p);
+        const Word* bits = frame.planes(p);
+        for (std::size_t k = 0; k < BitPlaneFrame<Word>::planes_per_pixel; ++k) {
+            *out++ = active;
+            *out++ = Word(bits[k] & active);
+            *out++ = 0;
+        }
+    }
+    return out;
+}
+
+/// Port words of the whole frame, parallel_units<Word>(frame.pixels()) of
+/// them. Append RET padding (encode_idle) as with encode_parallel().
+template <typename Word>
+inline Word* encode_bitplanes(const BitPlaneFrame<Word>& frame, Word* out) noexcept
+{
+    return encode_bitplanes_range(frame, 0, frame.pixels(), out);
+}
+
+} // namespace ws2812b
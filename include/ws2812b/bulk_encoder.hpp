@@ -0,0 +1,267 @@
+// Whole-frame encoder from packed RGB/RGBA pixels to Spi4 symbols.
+//
+// The kernel reorders every pixel into the chip's wire order (G, R, B by
+// default) and expands each data bit into its 4-bit symbol in one pass.
+// Vector paths are selected at compile time: AVX2 (32 pixels per
+// iteration), SSSE3/SSE4 (16), AArch64 NEON (16). The scalar path is the
+// chip encoder; it is also used for the tail of every frame, and all paths
+// produce identical output. Other formats and 4-channel chips always take
+// the scalar path.
+#pragma once
+
+#include "chip.hpp"
+#include "chip_encoder.hpp"
+#include "lut_encoder.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WS2812B_BULK_AVX2 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define WS2812B_BULK_SSSE3 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define WS2812B_BULK_NEON 1
+#endif
+
+namespace ws2812b {
+
+/// Memory layout of the source pixels.
+enum class PixelLayout : std::uint8_t {
+    rgb,  ///< r, g, b
+    rgba, ///< r, g, b, a; alpha is ignored
+};
+
+constexpr std::size_t stride(PixelLayout layout) noexcept
+{
+    return layout == PixelLayout::rgba ? 4 : 3;
+}
+
+/// Name of the kernel compiled in for the Spi4 path.
+inline constexpr const char* bulk_kernel_name =
+#if defined(WS2812B_BULK_AVX2)
+    "avx2";
+#elif defined(WS2812B_BULK_SSSE3)
+    "ssse3";
+#elif defined(WS2812B_BULK_NEON)
+    "neon";
+#else
+    "scalar";
+#endif
+
+namespace detail {
+
+/// Reorder-and-replicate shuffle for one block of 4 pixels: output vector
+/// `j` holds wire bytes 4j..4j+3, each repeated four times, one copy per
+/// output symbol byte.
+template <typename Order>
+constexpr std::array<std::array<std::uint8_t, 16>, 3> make_block_shuffle(std::size_t stride)
+{
+    static_assert(Order::channels == 3, "vector kernel handles 3-channel orders");
+    std::array<std::array<std::uint8_t, 16>, 3> idx{};
+    for (std::size_t j = 0; j < 3; ++j)
+        for (std::size_t o = 0; o < 16; ++o) {
+            const std::size_t wire = 4 * j + o / 4;
+            idx[j][o] = std::uint8_t((wire / 3) * stride + Order::src[wire % 3]);
+        }
+    return idx;
+}
+
+template <typename Order>
+struct BlockShuffle {
+    static constexpr auto rgb = make_block_shuffle<Order>(3);
+    static constexpr auto rgba = make_block_shuffle<Order>(4);
+};
+
+/// Output byte k of a data byte carries data bits 7-2k (high nibble) and
+/// 6-2k (low nibble).
+inline constexpr std::uint8_t bit_hi[16] = {0x80, 0x20, 0x08, 0x02, 0x80, 0x20, 0x08, 0x02,
+                                            0x80, 0x20, 0x08, 0x02, 0x80, 0x20, 0x08, 0x02};
+inline constexpr std::uint8_t bit_lo[16] = {0x40, 0x10, 0x04, 0x01, 0x40, 0x10, 0x04, 0x01,
+                                            0x40, 0x10, 0x04, 0x01, 0x40, 0x10, 0x04, 0x01};
+
+/// Pixels a vector iteration may read beyond its own, so that the last
+/// 16-byte load of an RGB block stays inside the frame.
+constexpr std::size_t slack(PixelLayout layout) noexcept
+{
+    return layout == PixelLayout::rgb ? 2 : 0;
+}
+
+#if defined(WS2812B_BULK_AVX2)
+
+inline __m256i load_pair(const std::uint8_t* a, const std::uint8_t* b) noexcept
+{
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)), 1);
+}
+
+inline __m256i broadcast16(const std::uint8_t* p) noexcept
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+template <typename Order>
+inline std::size_t encode_spi4_vector(const std::uint8_t* src, std::size_t n,
+                                      PixelLayout layout, std::uint8_t* out) noexcept
+{
+    const std::size_t s = stride(layout);
+    const auto& shuf = layout == PixelLayout::rgba ? BlockShuffle<Order>::rgba
+                                                   : BlockShuffle<Order>::rgb;
+    const __m256i sh0 = broadcast16(shuf[0].data());
+    const __m256i sh1 = broadcast16(shuf[1].data());
+    const __m256i sh2 = broadcast16(shuf[2].data());
+    const __m256i hi = broadcast16(bit_hi);
+    const __m256i lo = broadcast16(bit_lo);
+    const __m256i base = _mm256_set1_epi8(char(0x88));
+    const __m256i one_hi = _mm256_set1_epi8(0x60);
+    const __m256i one_lo = _mm256_set1_epi8(0x06);
+
+    auto expand = [&](__m256i v) {
+        const __m256i h = _mm256_cmpeq_epi8(_mm256_and_si256(v, hi), hi);
+        const __m256i l = _mm256_cmpeq_epi8(_mm256_and_si256(v, lo), lo);
+        return _mm256_or_si256(base, _mm256_or_si256(_mm256_and_si256(h, one_hi),
+                                                     _mm256_and_si256(l, one_lo)));
+    };
+
+    std::size_t i = 0;
+    for (; i + 32 + slack(layout) <= n; i += 32) {
+        for (std::size_t q = 0; q < 32; q += 8) {
+            const std::uint8_t* p = src + (i + q) * s;
+            const __m256i x = load_pair(p, p + 4 * s);
+            // Lane 0 encodes pixels 0..3, lane 1 pixels 4..7.
+            const __m256i r0 = expand(_mm256_shuffle_epi8(x, sh0));
+            const __m256i r1 = expand(_mm256_shuffle_epi8(x, sh1));
+            const __m256i r2 = expand(_mm256_shuffle_epi8(x, sh2));
+            __m256i* o = reinterpret_cast<__m256i*>(out + (i + q) * 12);
+            _mm256_storeu_si256(o + 0, _mm256_permute2x128_si256(r0, r1, 0x20));
+            _mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(r2, r0, 0x30));
+            _mm256_storeu_si256(o + 2, _mm256_permute2x128_si256(r1, r2, 0x31));
+        }
+    }
+    return i;
+}
+
+#elif defined(WS2812B_BULK_SSSE3)
+
+inline __m128i load16(const std::uint8_t* p) noexcept
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+template <typename Order>
+inline std::size_t encode_spi4_vector(const std::uint8_t* src, std::size_t n,
+                                      PixelLayout layout, std::uint8_t* out) noexcept
+{
+    const std::size_t s = stride(layout);
+    const auto& shuf = layout == PixelLayout::rgba ? BlockShuffle<Order>::rgba
+                                                   : BlockShuffle<Order>::rgb;
+    const __m128i sh0 = load16(shuf[0].data());
+    const __m128i sh1 = load16(shuf[1].data());
+    const __m128i sh2 = load16(shuf[2].data());
+    const __m128i hi = load16(bit_hi);
+    const __m128i lo = load16(bit_lo);
+    const __m128i base = _mm_set1_epi8(char(0x88));
+    const __m128i one_hi = _mm_set1_epi8(0x60);
+    const __m128i one_lo = _mm_set1_epi8(0x06);
+
+    auto expand = [&](__m128i v) {
+        const __m128i h = _mm_cmpeq_epi8(_mm_and_si128(v, hi), hi);
+        const __m128i l = _mm_cmpeq_epi8(_mm_and_si128(v, lo), lo);
+        return _mm_or_si128(base, _mm_or_si128(_mm_and_si128(h, one_hi),
+                                               _mm_and_si128(l, one_lo)));
+    };
+
+    std::size_t i = 0;
+    for (; i + 16 + slack(layout) <= n; i += 16) {
+        for (std::size_t q = 0; q < 16; q += 4) {
+            const __m128i x = load16(src + (i + q) * s);
+            __m128i* o = reinterpret_cast<__m128i*>(out + (i + q) * 12);
+            _mm_storeu_si128(o + 0, expand(_mm_shuffle_epi8(x, sh0)));
+            _mm_storeu_si128(o + 1, expand(_mm_shuffle_epi8(x, sh1)));
+            _mm_storeu_si128(o + 2, expand(_mm_shuffle_epi8(x, sh2)));
+        }
+    }
+    return i;
+}
+
+#elif defined(WS2812B_BULK_NEON)
+
+template <typename Order>
+inline std::size_t encode_spi4_vector(const std::uint8_t* src, std::size_t n,
+                                      PixelLayout layout, std::uint8_t* out) noexcept
+{
+    const std::size_t s = stride(layout);
+    const auto& shuf = layout == PixelLayout::rgba ? BlockShuffle<Order>::rgba
+                                                   : BlockShuffle<Order>::rgb;
+    const uint8x16_t sh0 = vld1q_u8(shuf[0].data());
+    const uint8x16_t sh1 = vld1q_u8(shuf[1].data());
+    const uint8x16_t sh2 = vld1q_u8(shuf[2].data());
+    const uint8x16_t hi = vld1q_u8(bit_hi);
+    const uint8x16_t lo = vld1q_u8(bit_lo);
+    const uint8x16_t base = vdupq_n_u8(0x88);
+    const uint8x16_t one_hi = vdupq_n_u8(0x60);
+    const uint8x16_t one_lo = vdupq_n_u8(0x06);
+
+    auto expand = [&](uint8x16_t v) {
+        const uint8x16_t h = vandq_u8(vtstq_u8(v, hi), one_hi);
+        const uint8x16_t l = vandq_u8(vtstq_u8(v, lo), one_lo);
+        return vorrq_u8(base, vorrq_u8(h, l));
+    };
+
+    std::size_t i = 0;
+    for (; i + 16 + slack(layout) <= n; i += 16) {
+        for (std::size_t q = 0; q < 16; q += 4) {
+            const uint8x16_t x = vld1q_u8(src + (i + q) * s);
+            std::uint8_t* o = out + (i + q) * 12;
+            vst1q_u8(o + 0, expand(vqtbl1q_u8(x, sh0)));
+            vst1q_u8(o + 16, expand(vqtbl1q_u8(x, sh1)));
+            vst1q_u8(o + 32, expand(vqtbl1q_u8(x, sh2)));
+        }
+    }
+    return i;
+}
+
+#endif
+
+} // namespace detail
+
+/// Reference path: encodes pixel by pixel through the chip encoder.
+template <typename Format, typename ChipT = Ws2812b>
+inline typename Format::unit_type* encode_frame_scalar(const std::uint8_t* src, std::size_t n,
+                                                       PixelLayout layout,
+                                                       typename Format::unit_type* out) noexcept
+{
+    struct Px3 { std::uint8_t c[3]; };
+    struct Px4 { std::uint8_t c[4]; };
+    if (layout == PixelLayout::rgba)
+        return encode_chip<ChipT, Format>(reinterpret_cast<const Px4*>(src), n, out);
+    return encode_chip<ChipT, Format>(reinterpret_cast<const Px3*>(src), n, out);
+}
+
+/// Encodes `n` packed pixels from `src` into
+/// `chip_encoded_units<ChipT, Format>(n)` units at `out`. Returns one past
+/// the last unit written.
+template <typename Format, typename ChipT = Ws2812b>
+inline typename Format::unit_type* encode_frame(const std::uint8_t* src, std::size_t n,
+                                                PixelLayout layout,
+                                                typename Format::unit_type* out) noexcept
+{
+#if defined(WS2812B_BULK_AVX2) || defined(WS2812B_BULK_SSSE3) || defined(WS2812B_BULK_NEON)
+    if constexpr (std::is_same<Format, Spi4>::value && ChipT::channels == 3) {
+        const std::size_t done =
+            detail::encode_spi4_vector<typename ChipT::order>(src, n, layout, out);
+        src += done * stride(layout);
+        out += encoded_units<Spi4>(done);
+        n -= done;
+    }
+#endif
+    return encode_frame_scalar<Format, ChipT>(src, n, layout, out);
+}
+
+} // namespace ws2812b
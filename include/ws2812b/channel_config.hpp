@@ -0,0 +1,50 @@
+// Per-channel configuration shared by pacing and calibration.
+#pragma once
+
+#include "chip.hpp"
+#include "timing.hpp"
+#include "timing_profile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// One output line: how many pixels it drives and how it is timed.
+struct ChannelConfig {
+    std::size_t pixels = 0;
+    Timing timing = ws2812b_timing;
+    std::size_t pixel_bits = bits_per_pixel;
+    /// Reset gap actually used; 0 means the datasheet RET of `timing`.
+    std::uint32_t reset_ns = 0;
+
+    template <typename ChipT>
+    static constexpr ChannelConfig for_chip(std::size_t pixels) noexcept
+    {
+        return ChannelConfig{pixels, ChipT::timing, ChipT::bits_per_pixel, 0};
+    }
+
+    /// Paced by what `Format` puts on the wire for `ChipT`, which is
+    /// shorter than the chip's nominal timing for fast SPI solutions.
+    template <typename ChipT, typename Format>
+    static constexpr ChannelConfig for_format(std::size_t pixels) noexcept
+    {
+        return ChannelConfig{pixels, wire_timing<Format>(ChipT::timing), ChipT::bits_per_pixel, 0};
+    }
+
+    constexpr std::uint32_t effective_reset_ns() const noexcept
+    {
+        return reset_ns != 0 ? reset_ns : timing.reset_ns;
+    }
+
+    /// Time one frame occupies the line, RET included.
+    constexpr std::uint64_t frame_ns() const noexcept
+    {
+        return std::uint64_t(pixels) * pixel_bits * timing.bit_ns() + effective_reset_ns();
+    }
+
+    /// Highest refresh rate the line can carry, in frames per second.
+    constexpr double max_fps() const noexcept { return 1e9 / double(frame_ns()); }
+};
+
+} // namespace ws2812b
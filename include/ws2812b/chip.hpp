@@ -0,0 +1,53 @@
+// Chip variants: wire colour order, channel count and timing as types, so
+// every encoder built on them is specialized at compile time.
+#pragma once
+
+#include "timing.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// Renderer-side channel indices: r, g, b, w as in Rgb/Rgbw.
+inline constexpr std::uint8_t ch_r = 0;
+inline constexpr std::uint8_t ch_g = 1;
+inline constexpr std::uint8_t ch_b = 2;
+inline constexpr std::uint8_t ch_w = 3;
+
+/// Wire order of a chip: `Src...` are the renderer channels sent first to
+/// last, e.g. ChannelOrder<ch_g, ch_r, ch_b> for WS2812B.
+template <std::uint8_t... Src>
+struct ChannelOrder {
+    static constexpr std::size_t channels = sizeof...(Src);
+    static constexpr std::uint8_t src[channels] = {Src...};
+};
+
+using OrderGrb = ChannelOrder<ch_g, ch_r, ch_b>;
+using OrderRgb = ChannelOrder<ch_r, ch_g, ch_b>;
+using OrderBrg = ChannelOrder<ch_b, ch_r, ch_g>;
+using OrderGrbw = ChannelOrder<ch_g, ch_r, ch_b, ch_w>;
+using OrderRgbw = ChannelOrder<ch_r, ch_g, ch_b, ch_w>;
+
+/// A chip variant: wire order plus line timing.
+template <typename Order, const Timing& T>
+struct Chip {
+    using order = Order;
+    static constexpr std::size_t channels = Order::channels;
+    static constexpr std::size_t bits_per_pixel = 8 * channels;
+    static constexpr Timing timing = T;
+
+    static constexpr std::uint64_t frame_wire_ns(std::size_t pixels) noexcept
+    {
+        return ws2812b::frame_wire_ns(pixels, timing, bits_per_pixel);
+    }
+};
+
+/// The part described by the datasheet.
+using Ws2812b = Chip<OrderGrb, ws2812b_timing>;
+/// WS2812B-timed clones wired R, G, B.
+using Ws2812bRgb = Chip<OrderRgb, ws2812b_timing>;
+using Sk6812 = Chip<OrderGrb, sk6812_timing>;
+using Sk6812Rgbw = Chip<OrderGrbw, sk6812_timing>;
+
+} // namespace ws2812b
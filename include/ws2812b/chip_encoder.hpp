@@ -0,0 +1,77 @@
+// Encoder specialized at compile time for a chip's wire order and
+// channel count.
+#pragma once
+
+#include "chip.hpp"
+#include "lut_encoder.hpp"
+#include "pixel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ws2812b {
+
+namespace detail {
+
+/// Encodes one pixel of `Stride` renderer bytes in wire order; channels
+/// the source does not have (white from an RGB source) are sent as 0.
+template <typename Format, std::size_t Stride, std::uint8_t... Src>
+inline typename Format::unit_type* encode_ordered(const std::uint8_t* p,
+                                                  typename Format::unit_type* out,
+                                                  ChannelOrder<Src...>) noexcept
+{
+    constexpr std::size_t step = Format::units_per_byte;
+    ((std::memcpy(out, Format::table[Src < Stride ? p[Src] : 0].data(),
+                  sizeof(typename Format::unit_type) * step),
+      out += step),
+     ...);
+    return out;
+}
+
+} // namespace detail
+
+/// Units needed to encode `pixels` pixels of `ChipT`, without reset padding.
+template <typename ChipT, typename Format>
+constexpr std::size_t chip_encoded_units(std::size_t pixels) noexcept
+{
+    return pixels * ChipT::channels * Format::units_per_byte;
+}
+
+/// Encodes `n` renderer pixels (Rgb, Rgbw or any tightly packed struct with
+/// channels in r, g, b, w order) for `ChipT`. The loop body is the chip's
+/// channel sequence unrolled: no per-pixel or per-channel decisions.
+template <typename ChipT, typename Format, typename Pixel>
+inline typename Format::unit_type* encode_chip(const Pixel* px, std::size_t n,
+                                               typename Format::unit_type* out) noexcept
+{
+    static_assert(symbols_fit<Format>(ChipT::timing), "format symbols violate the chip's timing");
+    constexpr std::size_t stride = sizeof(Pixel);
+    const auto* p = reinterpret_cast<const std::uint8_t*>(px);
+    for (std::size_t i = 0; i < n; ++i, p += stride)
+        out = detail::encode_ordered<Format, stride>(p, out, typename ChipT::order{});
+    return out;
+}
+
+/// Index in a gather table for a wire position with no source pixel.
+inline constexpr std::uint32_t no_pixel = ~std::uint32_t(0);
+
+/// As encode_chip(), but wire pixel `i` is `canvas[gather[i]]`, or black
+/// for no_pixel: the renderer's layout is read in wire order directly.
+template <typename ChipT, typename Format, typename Pixel>
+inline typename Format::unit_type* encode_chip_gather(const Pixel* canvas, const std::uint32_t* gather,
+                                                      std::size_t n,
+                                                      typename Format::unit_type* out) noexcept
+{
+    static_assert(symbols_fit<Format>(ChipT::timing), "format symbols violate the chip's timing");
+    constexpr std::size_t stride = sizeof(Pixel);
+    static const std::uint8_t black[stride] = {};
+    const auto* base = reinterpret_cast<const std::uint8_t*>(canvas);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint8_t* p = gather[i] == no_pixel ? black : base + std::size_t(gather[i]) * stride;
+        out = detail::encode_ordered<Format, stride>(p, out, typename ChipT::order{});
+    }
+    return out;
+}
+
+} // namespace ws2812b
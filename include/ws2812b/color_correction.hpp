@@ -0,0 +1,153 @@
+// Gamma, global brightness and white balance folded into the symbol
+// tables, so correction costs nothing beyond the encode pass itself.
+#pragma once
+
+#include "chip.hpp"
+#include "chip_encoder.hpp"
+#include "symbol_format.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace ws2812b {
+
+/// Correction applied to every renderer value `v` of channel `c`:
+/// 255 * (v / 255)^gamma * brightness / 255 * white[c] / 255.
+struct ColorCorrection {
+    float gamma = 1.0f;
+    std::uint8_t brightness = 255;
+    std::uint8_t white[4] = {255, 255, 255, 255}; ///< per renderer channel r, g, b, w
+
+    friend bool operator==(const ColorCorrection& a, const ColorCorrection& b) noexcept
+    {
+        return a.gamma == b.gamma && a.brightness == b.brightness &&
+               std::memcmp(a.white, b.white, sizeof a.white) == 0;
+    }
+    friend bool operator!=(const ColorCorrection& a, const ColorCorrection& b) noexcept
+    {
+        return !(a == b);
+    }
+};
+
+/// Corrected output of every input value of renderer channel `channel`,
+/// in 8.8 fixed point (0..0xFF00), for stages that keep the fraction.
+inline std::array<std::uint16_t, 256> correction_curve(const ColorCorrection& c,
+                                                       std::uint8_t channel)
+{
+    std::array<std::uint16_t, 256> curve{};
+    const double scale = 255.0 * 256.0 * (c.brightness / 255.0) * (c.white[channel] / 255.0);
+    for (unsigned v = 0; v < 256; ++v)
+        curve[v] = std::uint16_t(std::lround(std::pow(v / 255.0, double(c.gamma)) * scale));
+    return curve;
+}
+
+/// Chip encoder whose per-channel symbol tables already include a
+/// ColorCorrection. Setting a correction only marks the tables stale; they
+/// are rebuilt by the next encode(), so frames pay nothing unless the
+/// settings changed. Not thread-safe: change settings from the encoding
+/// thread, between frames.
+template <typename ChipT, typename Format>
+class CorrectedEncoder {
+public:
+    using unit_type = typename Format::unit_type;
+    using entry_type = std::array<unit_type, Format::units_per_byte>;
+
+    explicit CorrectedEncoder(const ColorCorrection& c = ColorCorrection{}) : correction_(c) {}
+
+    const ColorCorrection& correction() const noexcept { return correction_; }
+
+    void set_correction(const ColorCorrection& c) noexcept
+    {
+        if (c != correction_) {
+            correction_ = c;
+            stale_ = true;
+        }
+    }
+
+    void set_gamma(float gamma) noexcept
+    {
+        ColorCorrection c = correction_;
+        c.gamma = gamma;
+        set_correction(c);
+    }
+
+    void set_brightness(std::uint8_t brightness) noexcept
+    {
+        ColorCorrection c = correction_;
+        c.brightness = brightness;
+        set_correction(c);
+    }
+
+    void set_white_balance(std::uint8_t r, std::uint8_t g, std::uint8_t b,
+                           std::uint8_t w = 255) noexcept
+    {
+        ColorCorrection c = correction_;
+        c.white[ch_r] = r;
+        c.white[ch_g] = g;
+        c.white[ch_b] = b;
+        c.white[ch_w] = w;
+        set_correction(c);
+    }
+
+    /// Rebuilds the tables now rather than in the next encode().
+    void rebuild()
+    {
+        build(std::make_index_sequence<ChipT::channels>{});
+        stale_ = false;
+    }
+
+    /// Encodes `n` renderer pixels with correction in one pass.
+    template <typename Pixel>
+    unit_type* encode(const Pixel* px, std::size_t n, unit_type* out)
+    {
+        static_assert(symbols_fit<Format>(ChipT::timing), "format symbols violate the chip's timing");
+        if (stale_)
+            rebuild();
+        constexpr std::size_t stride = sizeof(Pixel);
+        const auto* p = reinterpret_cast<const std::uint8_t*>(px);
+        for (std::size_t i = 0; i < n; ++i, p += stride)
+            out = encode_pixel<stride>(p, out, std::make_index_sequence<ChipT::channels>{});
+        return out;
+    }
+
+    /// Table of wire position `k` (0 = first channel sent).
+    const std::array<entry_type, 256>& table(std::size_t k) const noexcept { return tables_[k]; }
+
+private:
+    template <std::size_t... K>
+    void build(std::index_sequence<K...>)
+    {
+        (build_one(K, ChipT::order::src[K]), ...);
+    }
+
+    void build_one(std::size_t k, std::uint8_t channel)
+    {
+        const auto curve = correction_curve(correction_, channel);
+        for (unsigned v = 0; v < 256; ++v) {
+            const std::uint8_t corrected = std::uint8_t((curve[v] + 0x80) >> 8);
+            std::memcpy(tables_[k][v].data(), Format::table[corrected].data(), sizeof(entry_type));
+        }
+    }
+
+    template <std::size_t Stride, std::size_t... K>
+    unit_type* encode_pixel(const std::uint8_t* p, unit_type* out, std::index_sequence<K...>) const
+    {
+        constexpr std::size_t step = Format::units_per_byte;
+        ((std::memcpy(out,
+                      tables_[K][ChipT::order::src[K] < Stride ? p[ChipT::order::src[K]] : 0].data(),
+                      sizeof(entry_type)),
+          out += step),
+         ...);
+        return out;
+    }
+
+    ColorCorrection correction_;
+    bool stale_ = true;
+    std::array<entry_type, 256> tables_[ChipT::channels];
+};
+
+} // namespace ws2812b
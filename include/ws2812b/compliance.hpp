@@ -0,0 +1,153 @@
+// Checks measured pulses against the datasheet windows and collects
+// width histograms.
+#pragma once
+
+#include "timing.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ws2812b {
+
+/// Fixed-width bucket histogram of nanosecond values with exact min/max.
+class Histogram {
+public:
+    Histogram(std::uint32_t bucket_ns, std::size_t buckets)
+        : bucket_ns_(bucket_ns), counts_(buckets + 1, 0) {}
+
+    void add(std::uint64_t ns)
+    {
+        const std::size_t b = std::size_t(ns / bucket_ns_);
+        ++counts_[b < counts_.size() - 1 ? b : counts_.size() - 1];
+        if (total_ == 0 || ns < min_)
+            min_ = ns;
+        if (ns > max_)
+            max_ = ns;
+        ++total_;
+    }
+
+    /// Upper bound of the bucket holding quantile `q` (0..1); exact max for
+    /// the overflow bucket.
+    std::uint64_t percentile(double q) const
+    {
+        if (total_ == 0)
+            return 0;
+        const std::uint64_t rank = std::uint64_t(q * double(total_ - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b + 1 < counts_.size(); ++b) {
+            seen += counts_[b];
+            if (seen >= rank) {
+                const std::uint64_t upper = std::uint64_t(b + 1) * bucket_ns_;
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+    std::uint64_t count() const noexcept { return total_; }
+    std::uint64_t min() const noexcept { return min_; }
+    std::uint64_t max() const noexcept { return max_; }
+
+    void clear()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = min_ = max_ = 0;
+    }
+
+private:
+    std::uint32_t bucket_ns_;
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t total_ = 0;
+    std::uint64_t min_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+/// Classifies a run stream into 0-codes, 1-codes and RET and checks every
+/// width against `Timing`. Feed it with render_waveform() or
+/// edges_to_runs(), then read the counters and histograms.
+///
+/// The low time of the last bit before RET is part of the reset and is not
+/// checked on its own. A low that is longer than T0L/T1L allow but shorter
+/// than RET is a gap, typically an inter-byte pause of the peripheral; some
+/// parts latch on it and some do not.
+class ComplianceChecker {
+public:
+    explicit ComplianceChecker(const Timing& t = ws2812b_timing)
+        : timing(t),
+          t0h(1, 2000), t1h(1, 2000), t0l(1, 2000), t1l(1, 2000),
+          reset(1000, 1000) {}
+
+    /// Accepts one run of the line at `level` for `ps` picoseconds.
+    void operator()(bool level, std::uint64_t ps)
+    {
+        const std::uint64_t ns = (ps + 500) / 1000;
+        if (level) {
+            if (pending_high_ != 0)
+                ++bad_low;  // two highs in a row cannot happen; count as a lost low
+            pending_high_ = ns;
+            return;
+        }
+        if (ns >= timing.reset_ns) {
+            if (pending_high_ != 0)
+                classify_high(pending_high_);
+            if (bits_in_frame_ != 0) {
+                ++frames;
+                if (bits_in_frame_ % bits_per_pixel != 0)
+                    ++partial_frames;
+                reset.add(ns);
+            }
+            pending_high_ = 0;
+            bits_in_frame_ = 0;
+            return;
+        }
+        if (pending_high_ == 0) {
+            ++bad_low;  // low without a preceding high, e.g. capture started mid-bit
+            return;
+        }
+        const bool one = classify_high(pending_high_);
+        const std::uint32_t nominal = one ? timing.t1l_ns : timing.t0l_ns;
+        (one ? t1l : t0l).add(ns);
+        if (ns > nominal + timing.tolerance_ns)
+            ++gaps;
+        else if (ns + timing.tolerance_ns < nominal)
+            ++bad_low;
+        pending_high_ = 0;
+    }
+
+    /// Total out-of-window pulses of any kind.
+    std::uint64_t violations() const noexcept { return bad_high + bad_low + gaps + partial_frames; }
+
+    std::uint64_t bits = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t bad_high = 0;       ///< high outside both T0H and T1H windows
+    std::uint64_t bad_low = 0;        ///< low shorter than its T0L/T1L window
+    std::uint64_t gaps = 0;           ///< low longer than its window but below RET
+    std::uint64_t partial_frames = 0; ///< frames not a multiple of 24 bits
+
+    const Timing timing;
+    Histogram t0h, t1h, t0l, t1l, reset;
+
+private:
+    /// Records a high pulse; returns true for a 1-code.
+    bool classify_high(std::uint64_t ns)
+    {
+        const auto within = [&](std::uint32_t nominal) {
+            return ns + timing.tolerance_ns >= nominal && ns <= nominal + timing.tolerance_ns;
+        };
+        const std::uint32_t mid = (timing.t0h_ns + timing.t1h_ns) / 2;
+        const bool one = ns >= mid;
+        if (!within(one ? timing.t1h_ns : timing.t0h_ns))
+            ++bad_high;
+        (one ? t1h : t0h).add(ns);
+        ++bits;
+        ++bits_in_frame_;
+        return one;
+    }
+
+    std::uint64_t pending_high_ = 0;
+    std::uint64_t bits_in_frame_ = 0;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,355 @@
+// Delta-compressed show file of wire-order pixel frames.
+//
+// Layout, little-endian: a DeltaFileHeader, then one record per frame,
+// then the keyframe index (`keyframes` DeltaKeyframe entries at
+// `index_offset`). A record is a u32 (payload bytes | key_record) followed
+// by a run list against the previous frame, or against black for a
+// keyframe:
+//
+//   op = (count << 2) | kind as LEB128, kind 0: skip `count` pixels,
+//   1: `count` literal Grb pixels follow, 2: one Grb follows, repeated.
+//
+// Mostly static shows shrink to a few bytes per frame, and decoding writes
+// only the changed runs into a DirtyFrame, so its dirty prefix is exactly
+// what has to be retransmitted.
+#pragma once
+
+#include "dirty_frame.hpp"
+#include "pixel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ws2812b {
+
+struct DeltaFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_bytes;
+    std::uint32_t pixels;
+    std::uint32_t frame_interval_us;
+    std::uint32_t keyframe_interval;
+    std::uint32_t reserved;
+    std::uint64_t frame_count;
+    std::uint64_t keyframes;
+    std::uint64_t index_offset;
+};
+
+struct DeltaKeyframe {
+    std::uint64_t frame;
+    std::uint64_t offset;
+};
+
+static_assert(sizeof(DeltaFileHeader) == 56, "DeltaFileHeader layout is part of the file format");
+
+inline constexpr char delta_file_magic[8] = {'W', 'S', '2', '8', '1', '2', 'D', 'F'};
+inline constexpr std::uint32_t delta_file_version = 1;
+inline constexpr std::uint32_t key_record = 0x80000000u;
+
+namespace detail {
+
+enum : unsigned { run_skip = 0, run_literal = 1, run_fill = 2 };
+
+inline void put_leb128(std::vector<std::uint8_t>& out, std::uint64_t v)
+{
+    do {
+        std::uint8_t b = v & 0x7F;
+        v >>= 7;
+        out.push_back(v ? b | 0x80 : b);
+    } while (v);
+}
+
+inline bool get_leb128(const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t& v) noexcept
+{
+    v = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        const std::uint8_t b = *p++;
+        v |= std::uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+} // namespace detail
+
+/// Records a show frame by frame, choosing skip, fill and literal runs.
+class DeltaFileWriter {
+public:
+    DeltaFileWriter() = default;
+    DeltaFileWriter(const DeltaFileWriter&) = delete;
+    DeltaFileWriter& operator=(const DeltaFileWriter&) = delete;
+    ~DeltaFileWriter() { close(); }
+
+    /// Creates `path`; every `keyframe_interval`-th frame is stored whole so
+    /// a seek decodes at most that many records.
+    bool open(const char* path, std::uint32_t pixels, std::uint32_t frame_interval_us,
+              std::uint32_t keyframe_interval = 300)
+    {
+        close();
+        file_ = std::fopen(path, "wb");
+        if (!file_)
+            return false;
+        std::memset(&header_, 0, sizeof header_);
+        std::memcpy(header_.magic, delta_file_magic, sizeof header_.magic);
+        header_.version = delta_file_version;
+        header_.header_bytes = sizeof header_;
+        header_.pixels = pixels;
+        header_.frame_interval_us = frame_interval_us;
+        header_.keyframe_interval = keyframe_interval ? keyframe_interval : 1;
+        previous_.assign(pixels, Grb{0, 0, 0});
+        index_.clear();
+        offset_ = sizeof header_;
+        return std::fwrite(&header_, sizeof header_, 1, file_) == 1;
+    }
+
+    /// Appends one frame of `pixels` wire-order pixels.
+    bool append(const Grb* frame)
+    {
+        if (!file_)
+            return false;
+        const bool key = header_.frame_count % header_.keyframe_interval == 0;
+        if (key) {
+            index_.push_back(DeltaKeyframe{header_.frame_count, offset_});
+            previous_.assign(header_.pixels, Grb{0, 0, 0});
+        }
+        encode(frame);
+        const std::uint32_t word = std::uint32_t(record_.size()) | (key ? key_record : 0);
+        if (std::fwrite(&word, sizeof word, 1, file_) != 1 ||
+            std::fwrite(record_.data(), 1, record_.size(), file_) != record_.size())
+            return false;
+        offset_ += sizeof word + record_.size();
+        previous_.assign(frame, frame + header_.pixels);
+        ++header_.frame_count;
+        return true;
+    }
+
+    /// Writes the keyframe index and header, and closes the file.
+    bool close()
+    {
+        if (!file_)
+            return true;
+        header_.keyframes = index_.size();
+        header_.index_offset = offset_;
+        bool ok = std::fwrite(index_.data(), sizeof(DeltaKeyframe), index_.size(), file_) == index_.size() &&
+                  std::fseek(file_, 0, SEEK_SET) == 0 &&
+                  std::fwrite(&header_, sizeof header_, 1, file_) == 1;
+        ok = std::fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+private:
+    /// Short fills and skips cost more than the literal they interrupt.
+    static constexpr std::size_t min_fill = 3;
+    static constexpr std::size_t min_skip = 2;
+
+    void encode(const Grb* frame)
+    {
+        record_.clear();
+        const std::size_t n = header_.pixels;
+        std::size_t i = 0;
+        std::size_t literal = 0; // start of the pending literal run
+        auto flush = [&](std::size_t end) {
+            if (end == literal)
+                return;
+            detail::put_leb128(record_, std::uint64_t(end - literal) << 2 | detail::run_literal);
+            const auto* bytes = reinterpret_cast<const std::uint8_t*>(frame + literal);
+            record_.insert(record_.end(), bytes, bytes + 3 * (end - literal));
+        };
+        while (i < n) {
+            std::size_t same = i;
+            while (same < n && frame[same] == previous_[same])
+                ++same;
+            if (same - i >= min_skip || same == n) {
+                flush(i);
+                if (same > i)
+                    detail::put_leb128(record_, std::uint64_t(same - i) << 2 | detail::run_skip);
+                i = literal = same;
+                continue;
+            }
+            std::size_t run = i + 1;
+            while (run < n && frame[run] == frame[i])
+                ++run;
+            if (run - i >= min_fill) {
+                flush(i);
+                detail::put_leb128(record_, std::uint64_t(run - i) << 2 | detail::run_fill);
+                const auto* bytes = reinterpret_cast<const std::uint8_t*>(frame + i);
+                record_.insert(record_.end(), bytes, bytes + 3);
+                i = literal = run;
+                continue;
+            }
+            ++i;
+        }
+        flush(n);
+    }
+
+    std::FILE* file_ = nullptr;
+    DeltaFileHeader header_{};
+    std::vector<Grb> previous_;
+    std::vector<DeltaKeyframe> index_;
+    std::vector<std::uint8_t> record_;
+    std::uint64_t offset_ = 0;
+};
+
+/// Read-only mapping of a delta show file, decoded into a DirtyFrame.
+///
+/// Sequential playback applies one record per frame. Any other frame is
+/// reached from the nearest keyframe at or before it; decoding into the
+/// same DirtyFrame keeps only the net change dirty.
+class DeltaFile {
+public:
+    DeltaFile() = default;
+    DeltaFile(const DeltaFile&) = delete;
+    DeltaFile& operator=(const DeltaFile&) = delete;
+    ~DeltaFile() { close(); }
+
+    bool open(const char* path)
+    {
+        close();
+        fd_ = ::open(path, O_RDONLY);
+        if (fd_ < 0)
+            return false;
+        struct stat st;
+        if (::fstat(fd_, &st) != 0 || std::size_t(st.st_size) < sizeof(DeltaFileHeader)) {
+            close();
+            return false;
+        }
+        bytes_ = std::size_t(st.st_size);
+        void* p = ::mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base_ = static_cast<const std::uint8_t*>(p);
+        std::memcpy(&header_, base_, sizeof header_);
+        if (std::memcmp(header_.magic, delta_file_magic, sizeof header_.magic) != 0 ||
+            header_.version != delta_file_version || header_.index_offset > bytes_ ||
+            header_.keyframes > (bytes_ - header_.index_offset) / sizeof(DeltaKeyframe) ||
+            (header_.frame_count != 0 && header_.keyframes == 0)) {
+            close();
+            return false;
+        }
+        next_ = ~std::uint64_t(0);
+        return true;
+    }
+
+    void close() noexcept
+    {
+        if (base_)
+            ::munmap(const_cast<std::uint8_t*>(base_), bytes_);
+        base_ = nullptr;
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+    explicit operator bool() const noexcept { return base_ != nullptr; }
+
+    const DeltaFileHeader& header() const noexcept { return header_; }
+    std::uint64_t frames() const noexcept { return header_.frame_count; }
+
+    /// Brings `frame` (of header().pixels pixels) to show frame `i`.
+    /// Returns false if `i` is out of range or the file is corrupt.
+    bool decode(std::uint64_t i, DirtyFrame& frame) noexcept
+    {
+        if (i >= header_.frame_count || frame.size() < header_.pixels)
+            return false;
+        if (i != next_) {
+            const DeltaKeyframe key = keyframe_before(i);
+            cursor_ = key.offset;
+            next_ = key.frame;
+        }
+        for (; next_ <= i; ++next_) {
+            if (!apply(frame)) {
+                next_ = ~std::uint64_t(0);
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    DeltaKeyframe keyframe_before(std::uint64_t i) const noexcept
+    {
+        const auto* index = reinterpret_cast<const std::uint8_t*>(base_ + header_.index_offset);
+        std::uint64_t lo = 0, hi = header_.keyframes;
+        while (hi - lo > 1) {
+            const std::uint64_t mid = (lo + hi) / 2;
+            DeltaKeyframe k;
+            std::memcpy(&k, index + mid * sizeof k, sizeof k);
+            (k.frame <= i ? lo : hi) = mid;
+        }
+        DeltaKeyframe k;
+        std::memcpy(&k, index + lo * sizeof k, sizeof k);
+        return k;
+    }
+
+    bool apply(DirtyFrame& frame) noexcept
+    {
+        std::uint32_t word;
+        if (cursor_ + sizeof word > header_.index_offset)
+            return false;
+        std::memcpy(&word, base_ + cursor_, sizeof word);
+        const std::uint64_t payload = word & ~key_record;
+        const bool key = (word & key_record) != 0;
+        if (cursor_ + sizeof word + payload > header_.index_offset)
+            return false;
+        const std::uint8_t* p = base_ + cursor_ + sizeof word;
+        const std::uint8_t* end = p + payload;
+        cursor_ += sizeof word + payload;
+
+        const Grb black{0, 0, 0};
+        const std::size_t n = header_.pixels;
+        std::size_t at = 0;
+        while (p < end) {
+            std::uint64_t op;
+            if (!detail::get_leb128(p, end, op))
+                return false;
+            const std::uint64_t count = op >> 2;
+            if (count > n - at)
+                return false;
+            switch (op & 3) {
+            case detail::run_skip:
+                if (key)
+                    frame.fill(at, count, black);
+                break;
+            case detail::run_literal: {
+                if (std::uint64_t(end - p) < 3 * count)
+                    return false;
+                frame.write(at, reinterpret_cast<const Grb*>(p), count);
+                p += 3 * count;
+                break;
+            }
+            case detail::run_fill: {
+                if (end - p < 3)
+                    return false;
+                frame.fill(at, count, Grb{p[0], p[1], p[2]});
+                p += 3;
+                break;
+            }
+            default:
+                return false;
+            }
+            at += count;
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    const std::uint8_t* base_ = nullptr;
+    std::size_t bytes_ = 0;
+    DeltaFileHeader header_{};
+    std::uint64_t cursor_ = 0;
+    std::uint64_t next_ = ~std::uint64_t(0);
+};
+
+} // namespace ws2812b
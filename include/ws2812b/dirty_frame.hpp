@@ -0,0 +1,116 @@
+// Frame with dirty tracking for minimal-prefix retransmission.
+//
+// A cascade always consumes data from pixel 1, but pixels that receive no
+// bits before RET keep what they latched last. Sending only the pixels up
+// to the last changed one therefore updates the whole chain.
+#pragma once
+
+#include "arena.hpp"
+#include "lut_encoder.hpp"
+#include "pixel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace ws2812b {
+
+/// Pixels in wire order plus the length of the prefix that differs from
+/// what the chain currently shows.
+class DirtyFrame {
+public:
+    /// Starts fully dirty: the chain's contents are unknown at power-up.
+    explicit DirtyFrame(std::size_t pixels)
+        : owned_(new Grb[pixels]()), pixels_(owned_.get()), size_(pixels), dirty_end_(pixels)
+    {
+    }
+
+    /// Takes the pixel storage from `arena`.
+    DirtyFrame(Arena& arena, std::size_t pixels)
+        : pixels_(arena.allocate<Grb>(pixels)), size_(pixels), dirty_end_(pixels)
+    {
+    }
+
+    static constexpr ArenaLayout layout(std::size_t pixels) noexcept
+    {
+        return ArenaLayout{}.reserve<Grb>(pixels);
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    const Grb& operator[](std::size_t i) const noexcept { return pixels_[i]; }
+    const Grb* data() const noexcept { return pixels_; }
+
+    /// Sets pixel `i`; only an actual change extends the dirty prefix.
+    void set(std::size_t i, Grb c) noexcept
+    {
+        if (pixels_[i] != c) {
+            pixels_[i] = c;
+            dirty_end_ = std::max(dirty_end_, i + 1);
+        }
+    }
+
+    /// Copies `n` pixels starting at `first`.
+    void write(std::size_t first, const Grb* src, std::size_t n) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            set(first + i, src[i]);
+    }
+
+    void fill(Grb c) noexcept
+    {
+        for (std::size_t i = 0; i < size_; ++i)
+            set(i, c);
+    }
+
+    /// Sets `n` pixels starting at `first` to `c`.
+    void fill(std::size_t first, std::size_t n, Grb c) noexcept
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            set(first + i, c);
+    }
+
+    /// Pixels that must be sent to bring the chain up to date.
+    std::size_t dirty_prefix() const noexcept { return dirty_end_; }
+    bool dirty() const noexcept { return dirty_end_ != 0; }
+
+    /// Forces the next transmission to cover the whole chain, e.g. after
+    /// the strip lost power.
+    void mark_all_dirty() noexcept { dirty_end_ = size_; }
+
+    /// Declares the chain up to date.
+    void clear_dirty() noexcept { dirty_end_ = 0; }
+
+    /// Encodes the dirty prefix into `out` and clears it. Returns one past
+    /// the last unit written; `out` itself if nothing changed.
+    template <typename Format>
+    typename Format::unit_type* encode_dirty(typename Format::unit_type* out) noexcept
+    {
+        out = encode_pixels<Format>(pixels_, dirty_end_, out);
+        dirty_end_ = 0;
+        return out;
+    }
+
+private:
+    std::unique_ptr<Grb[]> owned_;
+    Grb* pixels_;
+    std::size_t size_;
+    std::size_t dirty_end_;
+};
+
+/// Sends the dirty prefix of `frame` through `engine`. Returns false, and
+/// leaves the frame dirty, if nothing changed or no buffer is free.
+template <typename Engine>
+bool transmit_dirty(Engine& engine, DirtyFrame& frame) noexcept
+{
+    using format = typename Engine::format_type;
+    if (!frame.dirty())
+        return false;
+    auto buffer = engine.acquire();
+    if (!buffer)
+        return false;
+    auto* end = frame.encode_dirty<format>(buffer.data);
+    engine.submit(buffer, std::size_t(end - buffer.data));
+    return true;
+}
+
+} // namespace ws2812b
@@ -0,0 +1,217 @@
+// Temporal dithering: carries the fraction lost when corrected values are
+// rounded to 8 bits into the next frame, so low brightness levels average
+// out between the 8-bit steps instead of banding.
+#pragma once
+
+#include "arena.hpp"
+#include "chip.hpp"
+#include "color_correction.hpp"
+#include "symbol_format.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ws2812b {
+
+/// Encoder applying ColorCorrection at 8.8 precision and dithering the
+/// result over time, fused into the encode pass.
+///
+/// The per-pixel error is kept structure-of-arrays, one byte per pixel and
+/// wire channel. Pixels are processed in chunks that stay in L1: corrected
+/// values are looked up, the error add/split runs as a branch-free loop
+/// over contiguous arrays the compiler vectorizes, and the chunk is then
+/// encoded through the symbol table. Frame memory is swept once.
+///
+/// Frames must always cover the same pixels in the same order; encode()
+/// with fewer pixels dithers only that prefix.
+template <typename ChipT, typename Format>
+class DitheringEncoder {
+public:
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t channels = ChipT::channels;
+    static constexpr std::size_t chunk = 64;
+
+    explicit DitheringEncoder(std::size_t pixels, const ColorCorrection& c = ColorCorrection{})
+        : owned_(new std::uint8_t[pixels * channels]()), pixels_(pixels), correction_(c)
+    {
+        for (std::size_t k = 0; k < channels; ++k)
+            error_[k] = owned_.get() + k * pixels;
+    }
+
+    DitheringEncoder(Arena& arena, std::size_t pixels, const ColorCorrection& c = ColorCorrection{})
+        : pixels_(pixels), correction_(c)
+    {
+        for (std::size_t k = 0; k < channels; ++k)
+            error_[k] = arena.allocate<std::uint8_t>(pixels, 64);
+    }
+
+    static constexpr ArenaLayout layout(std::size_t pixels) noexcept
+    {
+        ArenaLayout l;
+        for (std::size_t k = 0; k < channels; ++k)
+            l.reserve<std::uint8_t>(pixels, 64);
+        return l;
+    }
+
+    const ColorCorrection& correction() const noexcept { return correction_; }
+
+    /// Marks the curves stale; they are rebuilt by the next encode().
+    void set_correction(const ColorCorrection& c) noexcept
+    {
+        if (c != correction_) {
+            correction_ = c;
+            stale_ = true;
+        }
+    }
+
+    /// Clears the accumulated error, e.g. after a scene cut.
+    void reset_error() noexcept
+    {
+        for (std::size_t k = 0; k < channels; ++k)
+            std::memset(error_[k], 0, pixels_);
+    }
+
+    /// Encodes `n` (at most the constructed pixel count) renderer pixels.
+    template <typename Pixel>
+    unit_type* encode(const Pixel* px, std::size_t n, unit_type* out)
+    {
+        return encode_chunks(n, out, [&](std::size_t k, std::size_t base, std::size_t m, std::uint16_t* value) {
+            corrected(px, k, base, m, value);
+        });
+    }
+
+    /// Encodes the blend `t`/256 of the way from `from` to `to`. Both are
+    /// corrected first, so the blend is in linear light and its fraction
+    /// goes into the dither error like any other.
+    template <typename Pixel>
+    unit_type* encode_blend(const Pixel* from, const Pixel* to, std::uint32_t t, std::size_t n,
+                            unit_type* out)
+    {
+        if (t > 256)
+            t = 256;
+        std::uint16_t other[chunk];
+        return encode_chunks(n, out, [&](std::size_t k, std::size_t base, std::size_t m, std::uint16_t* value) {
+            corrected(from, k, base, m, value);
+            corrected(to, k, base, m, other);
+            blend(value, other, t, m);
+        });
+    }
+
+    /// As encode_blend(), from corrected values: `linear` holds one row of
+    /// the constructed pixel count per wire channel, 8.8 values as the
+    /// encoder computes them, so pixel `i` of channel `k` is
+    /// linear[k * pixels + i].
+    template <typename Pixel>
+    unit_type* encode_blend_linear(const std::uint16_t* linear, const Pixel* to, std::uint32_t t,
+                                   std::size_t n, unit_type* out)
+    {
+        if (t > 256)
+            t = 256;
+        std::uint16_t other[chunk];
+        return encode_chunks(n, out, [&](std::size_t k, std::size_t base, std::size_t m, std::uint16_t* value) {
+            std::memcpy(value, linear + k * pixels_ + base, m * sizeof *value);
+            corrected(to, k, base, m, other);
+            blend(value, other, t, m);
+        });
+    }
+
+    /// Blends `linear` (as above) `t`/256 of the way towards `to` in place,
+    /// leaving the values the blend encodes before dithering. Fill it from
+    /// a frame with t = 256.
+    template <typename Pixel>
+    void blend_linear(std::uint16_t* linear, const Pixel* to, std::uint32_t t, std::size_t n)
+    {
+        if (stale_)
+            rebuild();
+        if (t > 256)
+            t = 256;
+        std::uint16_t other[chunk];
+        for (std::size_t base = 0; base < n; base += chunk) {
+            const std::size_t m = n - base < chunk ? n - base : chunk;
+            for (std::size_t k = 0; k < channels; ++k) {
+                corrected(to, k, base, m, other);
+                blend(linear + k * pixels_ + base, other, t, m);
+            }
+        }
+    }
+
+    void rebuild()
+    {
+        for (std::size_t k = 0; k < channels; ++k)
+            curves_[k] = correction_curve(correction_, ChipT::order::src[k]);
+        stale_ = false;
+    }
+
+private:
+    /// Corrected values of wire channel `k` for pixels [base, base + m).
+    template <typename Pixel>
+    void corrected(const Pixel* px, std::size_t k, std::size_t base, std::size_t m,
+                   std::uint16_t* value) const noexcept
+    {
+        constexpr std::size_t stride = sizeof(Pixel);
+        const std::uint8_t c = ChipT::order::src[k];
+        const std::uint8_t* p = reinterpret_cast<const std::uint8_t*>(px) + base * stride + c;
+        for (std::size_t i = 0; i < m; ++i)
+            value[i] = curves_[k][c < stride ? p[i * stride] : 0];
+    }
+
+    /// Looks up a chunk with `load(k, base, m, value)`, dithers it and
+    /// encodes it through the symbol table.
+    template <typename Load>
+    unit_type* encode_chunks(std::size_t n, unit_type* out, Load&& load)
+    {
+        static_assert(symbols_fit<Format>(ChipT::timing), "format symbols violate the chip's timing");
+        if (stale_)
+            rebuild();
+        std::uint16_t value[channels][chunk];
+        std::uint8_t wire[channels][chunk];
+
+        for (std::size_t base = 0; base < n; base += chunk) {
+            const std::size_t m = n - base < chunk ? n - base : chunk;
+            for (std::size_t k = 0; k < channels; ++k)
+                load(k, base, m, value[k]);
+            for (std::size_t k = 0; k < channels; ++k)
+                dither(value[k], error_[k] + base, wire[k], m);
+            for (std::size_t i = 0; i < m; ++i)
+                for (std::size_t k = 0; k < channels; ++k) {
+                    std::memcpy(out, Format::table[wire[k][i]].data(),
+                                sizeof(unit_type) * Format::units_per_byte);
+                    out += Format::units_per_byte;
+                }
+        }
+        return out;
+    }
+
+    /// value = value + (other - value) * t / 256, branch-free over the chunk.
+    static void blend(std::uint16_t* value, const std::uint16_t* other, std::uint32_t t,
+                      std::size_t m) noexcept
+    {
+        const std::uint32_t s = 256 - t;
+        for (std::size_t i = 0; i < m; ++i)
+            value[i] = std::uint16_t((value[i] * s + other[i] * t) >> 8);
+    }
+
+    /// out = (value + error) >> 8, error = (value + error) & 0xFF. The sum
+    /// never exceeds 0xFF00 + 0xFF, so no saturation is needed.
+    static void dither(const std::uint16_t* value, std::uint8_t* error, std::uint8_t* out,
+                       std::size_t m) noexcept
+    {
+        for (std::size_t i = 0; i < m; ++i) {
+            const std::uint16_t sum = std::uint16_t(value[i] + error[i]);
+            out[i] = std::uint8_t(sum >> 8);
+            error[i] = std::uint8_t(sum);
+        }
+    }
+
+    std::unique_ptr<std::uint8_t[]> owned_;
+    std::uint8_t* error_[channels] = {};
+    std::size_t pixels_;
+    ColorCorrection correction_;
+    bool stale_ = true;
+    std::array<std::uint16_t, 256> curves_[channels];
+};
+
+} // namespace ws2812b
@@ -0,0 +1,201 @@
+// Work-stealing thread pool for the per-frame encode stage.
+//
+// A frame's encode work is split into independent tasks (one per strip,
+// or per pixel range). At the start of run() each worker gets an equal run
+// of task indices; a worker takes tasks from the front of its own run and,
+// once that is empty, steals single tasks from the back of the others',
+// so strips of unequal length or cost still finish together. run() returns
+// only when every task is done, which is the barrier before the frame is
+// transposed and submitted.
+#pragma once
+
+#include "parallel_output.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ws2812b {
+
+class EncodePool {
+public:
+    /// Starts `threads - 1` workers; the thread calling run() is the last.
+    explicit EncodePool(unsigned threads = std::thread::hardware_concurrency())
+        : queues_(new Queue[threads ? threads : 1]), threads_(threads ? threads : 1)
+    {
+        workers_.reserve(threads_ - 1);
+        for (unsigned i = 1; i < threads_; ++i)
+            workers_.emplace_back([this, i] { worker(i); });
+    }
+
+    EncodePool(const EncodePool&) = delete;
+    EncodePool& operator=(const EncodePool&) = delete;
+
+    ~EncodePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_)
+            t.join();
+    }
+
+    unsigned threads() const noexcept { return threads_; }
+
+    /// Calls `fn(task)` for every task in [0, tasks) across the pool and
+    /// returns once all have finished. Not reentrant: one run at a time.
+    template <typename Fn>
+    void run(std::size_t tasks, Fn&& fn)
+    {
+        if (tasks == 0)
+            return;
+        using F = typename std::remove_reference<Fn>::type;
+        call_ = [](void* ctx, std::size_t task) { (*static_cast<F*>(ctx))(task); };
+        ctx_ = const_cast<void*>(static_cast<const void*>(&fn));
+        done_.store(0, std::memory_order_relaxed);
+        for (unsigned w = 0; w < threads_; ++w) {
+            const std::uint64_t begin = tasks * w / threads_;
+            const std::uint64_t end = tasks * (w + 1) / threads_;
+            queues_[w].range.store(end << 32 | begin, std::memory_order_release);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++generation_;
+        }
+        wake_.notify_all();
+        work(0);
+        while (done_.load(std::memory_order_acquire) != tasks)
+            std::this_thread::yield();
+    }
+
+    /// Tasks taken from another worker's run since construction.
+    std::uint64_t steals() const noexcept { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Queue {
+        /// Remaining tasks [begin, end) packed as end << 32 | begin; the
+        /// owner pops at begin, thieves at end, both by CAS on one word.
+        std::atomic<std::uint64_t> range{0};
+    };
+
+    bool pop_front(unsigned w, std::size_t& task) noexcept
+    {
+        auto& r = queues_[w].range;
+        std::uint64_t cur = r.load(std::memory_order_acquire);
+        while (std::uint32_t(cur) < std::uint32_t(cur >> 32)) {
+            if (r.compare_exchange_weak(cur, cur + 1, std::memory_order_acq_rel)) {
+                task = std::uint32_t(cur);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool pop_back(unsigned w, std::size_t& task) noexcept
+    {
+        auto& r = queues_[w].range;
+        std::uint64_t cur = r.load(std::memory_order_acquire);
+        while (std::uint32_t(cur) < std::uint32_t(cur >> 32)) {
+            const std::uint64_t end = (cur >> 32) - 1;
+            if (r.compare_exchange_weak(cur, end << 32 | std::uint32_t(cur), std::memory_order_acq_rel)) {
+                task = std::size_t(end);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned self)
+    {
+        std::size_t task;
+        while (pop_front(self, task))
+            execute(task);
+        for (unsigned i = 1; i < threads_; ++i) {
+            const unsigned victim = (self + i) % threads_;
+            while (pop_back(victim, task)) {
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                execute(task);
+            }
+        }
+    }
+
+    void execute(std::size_t task)
+    {
+        call_(ctx_, task);
+        done_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void worker(unsigned self)
+    {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+            }
+            work(self);
+        }
+    }
+
+    std::unique_ptr<Queue[]> queues_;
+    unsigned threads_;
+    std::vector<std::thread> workers_;
+
+    // Written by run() before the queues are published and read only after
+    // a task has been claimed from them.
+    void (*call_)(void*, std::size_t) = nullptr;
+    void* ctx_ = nullptr;
+
+    alignas(64) std::atomic<std::size_t> done_{0};
+    std::atomic<std::uint64_t> steals_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+/// Encodes up to 32 strips for parallel output on `pool`: first
+/// `prepare(c)` for every strip (colour correction, dithering, effects
+/// into `strips[c].pixels`), one task per strip; then, after the barrier,
+/// the bit-transpose in chunks of `chunk_pixels`. Returns one past the last
+/// word written, like encode_parallel().
+template <typename Word, typename Prepare>
+Word* encode_parallel_sharded(EncodePool& pool, const Strip* strips, std::size_t channels,
+                              Word* out, Prepare&& prepare, std::size_t chunk_pixels = 64)
+{
+    if (channels > ParallelWords<Word>::channels)
+        channels = ParallelWords<Word>::channels;
+    pool.run(channels, prepare);
+
+    const std::size_t longest = longest_strip(strips, channels);
+    const std::size_t per_pixel = parallel_units<Word>(1);
+    const std::size_t chunks = (longest + chunk_pixels - 1) / chunk_pixels;
+    pool.run(chunks, [&](std::size_t i) {
+        const std::size_t first = i * chunk_pixels;
+        const std::size_t last = std::min(longest, first + chunk_pixels);
+        encode_parallel_range(strips, channels, first, last, out + first * per_pixel);
+    });
+    return out + longest * per_pixel;
+}
+
+/// As above with the strips already in wire order.
+template <typename Word>
+Word* encode_parallel_sharded(EncodePool& pool, const Strip* strips, std::size_t channels, Word* out)
+{
+    return encode_parallel_sharded(pool, strips, channels, out, [](std::size_t) {});
+}
+
+} // namespace ws2812b
@@ -0,0 +1,324 @@
+// Binary show file of fixed-size frames, memory-mapped for playback.
+//
+// Layout, little-endian: a FrameFileHeader, then `frame_count` frames of
+// `frame_bytes` each, starting at `data_offset` and `frame_stride` apart.
+// Offset and stride are multiples of `page_bytes`, the page size the file
+// was written for, so on a host with that page size (or a divisor of it)
+// every frame starts on its own page and can be handed to DMA straight from
+// the mapping. Files written for smaller pages still play. Windows are then
+// mapped from the host page below, and page_aligned() is false. Frames
+// hold either wire-order pixel bytes or symbols of a format, including RET
+// padding, identified by FormatId.
+//
+// On 32-bit targets build with -D_FILE_OFFSET_BITS=64 and open with a
+// window size: only that much of the file is mapped at a time.
+#pragma once
+
+#include "symbol_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ws2812b {
+
+struct FrameFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_bytes;
+    FormatId format;
+    std::uint32_t pixels;
+    std::uint32_t channels;
+    std::uint32_t frame_bytes;
+    std::uint32_t frame_interval_us;
+    std::uint64_t frame_count;
+    std::uint64_t frame_stride;
+    std::uint64_t data_offset;
+    std::uint32_t page_bytes;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(FrameFileHeader) == 80, "FrameFileHeader layout is part of the file format");
+static_assert(sizeof(off_t) >= 8, "build with -D_FILE_OFFSET_BITS=64 for multi-GB shows");
+
+inline constexpr char frame_file_magic[8] = {'W', 'S', '2', '8', '1', '2', 'F', 'F'};
+inline constexpr std::uint32_t frame_file_version = 2;
+
+/// Writes a show file frame by frame.
+class FrameFileWriter {
+public:
+    FrameFileWriter() = default;
+    FrameFileWriter(const FrameFileWriter&) = delete;
+    FrameFileWriter& operator=(const FrameFileWriter&) = delete;
+    ~FrameFileWriter() { close(); }
+
+    /// Creates `path`. `frame_bytes` is the payload size of every frame;
+    /// `page` the alignment of each frame, normally the target's page size;
+    /// 0 is rejected. It is recorded in the header; write for the largest
+    /// page size the file may be played on (e.g. 16384 for Apple silicon,
+    /// 65536 for some arm64 kernels).
+    bool open(const char* path, FormatId format, std::uint32_t pixels, std::uint32_t channels,
+              std::uint32_t frame_bytes, std::uint32_t frame_interval_us,
+              std::size_t page = 4096)
+    {
+        close();
+        if (page == 0 || page > UINT32_MAX)
+            return false;
+        file_ = std::fopen(path, "wb");
+        if (!file_)
+            return false;
+        std::memset(&header_, 0, sizeof header_);
+        std::memcpy(header_.magic, frame_file_magic, sizeof header_.magic);
+        header_.version = frame_file_version;
+        header_.header_bytes = sizeof header_;
+        header_.format = format;
+        header_.pixels = pixels;
+        header_.channels = channels;
+        header_.frame_bytes = frame_bytes;
+        header_.frame_interval_us = frame_interval_us;
+        header_.frame_stride = round_up(frame_bytes, page);
+        header_.data_offset = round_up(sizeof header_, page);
+        header_.page_bytes = std::uint32_t(page);
+        return write_header() && pad_to(header_.data_offset);
+    }
+
+    /// Appends one frame of `frame_bytes` bytes.
+    bool append(const void* frame)
+    {
+        const std::uint64_t at = header_.data_offset + header_.frame_count * header_.frame_stride;
+        if (!file_ || std::fwrite(frame, 1, header_.frame_bytes, file_) != header_.frame_bytes)
+            return false;
+        ++header_.frame_count;
+        return pad_to(at + header_.frame_stride);
+    }
+
+    /// Records the frame count and closes the file.
+    bool close()
+    {
+        if (!file_)
+            return true;
+        bool ok = ::fseeko(file_, 0, SEEK_SET) == 0 && write_header();
+        ok = std::fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+private:
+    static std::uint64_t round_up(std::uint64_t v, std::uint64_t page) noexcept
+    {
+        return (v + page - 1) / page * page;
+    }
+
+    bool write_header()
+    {
+        return std::fwrite(&header_, sizeof header_, 1, file_) == 1;
+    }
+
+    bool pad_to(std::uint64_t offset)
+    {
+        static const char zeros[256] = {};
+        // ftell() returns long, which a multi-GB show overflows on 32-bit
+        // targets; ftello() returns the 64-bit off_t.
+        const off_t at = ::ftello(file_);
+        if (at < 0)
+            return false;
+        std::uint64_t pos = std::uint64_t(at);
+        while (pos < offset) {
+            const std::size_t n = std::size_t(offset - pos < sizeof zeros ? offset - pos : sizeof zeros);
+            if (std::fwrite(zeros, 1, n, file_) != n)
+                return false;
+            pos += n;
+        }
+        return true;
+    }
+
+    std::FILE* file_ = nullptr;
+    FrameFileHeader header_{};
+};
+
+/// Read-only mapping of a show file.
+///
+/// With a window size, the file is mapped `window_bytes` at a time (rounded
+/// to whole frames). A pointer returned by frame() stays valid until the
+/// window has moved twice, which covers every frame queued on a
+/// TransmitEngine as long as a window holds more frames than it has
+/// buffers.
+class FrameFile {
+public:
+    FrameFile() = default;
+    FrameFile(const FrameFile&) = delete;
+    FrameFile& operator=(const FrameFile&) = delete;
+    ~FrameFile() { close(); }
+
+    /// Opens and validates `path`; `window_bytes` of 0 maps the whole file.
+    bool open(const char* path, std::size_t window_bytes = 0)
+    {
+        close();
+        fd_ = ::open(path, O_RDONLY);
+        if (fd_ < 0)
+            return false;
+        struct stat st;
+        if (::fstat(fd_, &st) != 0 || std::size_t(st.st_size) < sizeof header_ ||
+            ::pread(fd_, &header_, sizeof header_, 0) != ssize_t(sizeof header_) ||
+            std::memcmp(header_.magic, frame_file_magic, sizeof header_.magic) != 0 ||
+            header_.version != frame_file_version || header_.header_bytes != sizeof header_ ||
+            header_.frame_stride < header_.frame_bytes || header_.page_bytes == 0 ||
+            header_.frame_stride % header_.page_bytes != 0 ||
+            header_.data_offset % header_.page_bytes != 0 ||
+            std::uint64_t(st.st_size) <
+                header_.data_offset + header_.frame_count * header_.frame_stride) {
+            close();
+            return false;
+        }
+        host_page_ = std::uint64_t(::sysconf(_SC_PAGESIZE));
+        const std::uint64_t all = header_.frame_count;
+        window_frames_ = window_bytes == 0 ? all : window_bytes / header_.frame_stride;
+        if (window_frames_ == 0)
+            window_frames_ = 1;
+        if (window_frames_ > all)
+            window_frames_ = all;
+        return true;
+    }
+
+    void close()
+    {
+        for (auto& w : windows_)
+            unmap(w);
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+    explicit operator bool() const noexcept { return fd_ >= 0; }
+
+    const FrameFileHeader& header() const noexcept { return header_; }
+
+    /// True if every frame starts on a page of this host, i.e. the file was
+    /// written for this page size or a multiple of it.
+    bool page_aligned() const noexcept { return header_.page_bytes % host_page_ == 0; }
+    std::uint64_t frames() const noexcept { return header_.frame_count; }
+
+    /// True if the frames hold symbols of `Format`.
+    template <typename Format>
+    bool holds() const noexcept
+    {
+        return header_.format == format_id<Format>();
+    }
+
+    /// Frame `i`, or nullptr if it is out of range or cannot be mapped.
+    const void* frame(std::uint64_t i) noexcept
+    {
+        if (i >= header_.frame_count)
+            return nullptr;
+        for (const auto& w : windows_)
+            if (w.base && i >= w.first && i < w.first + w.count)
+                return w.base + (i - w.first) * header_.frame_stride;
+        // Slide: the current window becomes the previous one.
+        unmap(windows_[1]);
+        windows_[1] = windows_[0];
+        windows_[0] = Window{};
+        if (!map(windows_[0], i))
+            return nullptr;
+        return windows_[0].base;
+    }
+
+    /// Frame `i` as symbols of `Format`; check holds<Format>() first.
+    template <typename Format>
+    const typename Format::unit_type* symbols(std::uint64_t i) noexcept
+    {
+        return static_cast<const typename Format::unit_type*>(frame(i));
+    }
+
+    /// Units per frame of `Format`, RET padding included.
+    template <typename Format>
+    std::size_t frame_units() const noexcept
+    {
+        return header_.frame_bytes / sizeof(typename Format::unit_type);
+    }
+
+    /// Asks the kernel to start reading frames ahead of playback.
+    void prefetch(std::uint64_t first, std::uint64_t count) noexcept
+    {
+        advise(first, count, MADV_WILLNEED);
+    }
+
+    /// Unmaps the pages of frames already played and drops them from the
+    /// page cache, bounding resident memory on long shows. Pages that
+    /// another process still maps stay cached.
+    void evict(std::uint64_t first, std::uint64_t count) noexcept
+    {
+        advise(first, count, MADV_DONTNEED);
+        if (first < header_.frame_count) {
+            if (count > header_.frame_count - first)
+                count = header_.frame_count - first;
+            ::posix_fadvise(fd_, off_t(header_.data_offset + first * header_.frame_stride),
+                            off_t(count * header_.frame_stride), POSIX_FADV_DONTNEED);
+        }
+    }
+
+private:
+    struct Window {
+        std::uint8_t* base = nullptr; ///< frame `first`
+        std::uint8_t* map = nullptr;  ///< start of the mapping, at or before base
+        std::size_t bytes = 0;        ///< of the mapping
+        std::uint64_t first = 0;
+        std::uint64_t count = 0;
+    };
+
+    bool map(Window& w, std::uint64_t i) noexcept
+    {
+        const std::uint64_t first = i / window_frames_ * window_frames_;
+        const std::uint64_t count =
+            first + window_frames_ > header_.frame_count ? header_.frame_count - first
+                                                         : window_frames_;
+        // mmap offsets must be host-page aligned; with a file written for
+        // smaller pages, map from the host page below the window.
+        const std::uint64_t offset = header_.data_offset + first * header_.frame_stride;
+        const std::uint64_t lead = offset % host_page_;
+        const std::size_t bytes = std::size_t(lead + count * header_.frame_stride);
+        void* p = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd_, off_t(offset - lead));
+        if (p == MAP_FAILED)
+            return false;
+        auto* m = static_cast<std::uint8_t*>(p);
+        w = Window{m + lead, m, bytes, first, count};
+        return true;
+    }
+
+    static void unmap(Window& w) noexcept
+    {
+        if (w.map)
+            ::munmap(w.map, w.bytes);
+        w = Window{};
+    }
+
+    void advise(std::uint64_t first, std::uint64_t count, int advice) noexcept
+    {
+        for (const auto& w : windows_) {
+            if (!w.base)
+                continue;
+            const std::uint64_t lo = first > w.first ? first : w.first;
+            const std::uint64_t hi =
+                first + count < w.first + w.count ? first + count : w.first + w.count;
+            if (lo >= hi)
+                continue;
+            // madvise() takes host-page-aligned addresses.
+            std::uint8_t* at = w.base + (lo - w.first) * header_.frame_stride;
+            const std::size_t lead = std::size_t(at - w.map) % host_page_;
+            ::madvise(at - lead, lead + std::size_t((hi - lo) * header_.frame_stride), advice);
+        }
+    }
+
+    int fd_ = -1;
+    FrameFileHeader header_{};
+    std::uint64_t host_page_ = 4096;
+    std::uint64_t window_frames_ = 0;
+    Window windows_[2];
+};
+
+} // namespace ws2812b
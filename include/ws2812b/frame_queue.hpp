@@ -0,0 +1,84 @@
+// Wait-free single-producer/single-consumer frame handoff, latest frame wins.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// Three-slot frame ring between one renderer thread and the real-time
+/// transmit thread.
+///
+/// The producer always owns one slot to render into and the consumer one
+/// slot to transmit from; the third holds the newest published frame.
+/// Publishing swaps the producer's slot with it, so a frame the consumer
+/// has not picked up yet is replaced, never waited for, and counted as
+/// dropped. Both sides are a single atomic exchange: wait-free, bounded,
+/// and no slot is ever touched by two threads at once.
+///
+/// Frames carry a deadline in the caller's time base; a frame picked up
+/// after its deadline is counted as late.
+template <typename T>
+class FrameQueue {
+public:
+    FrameQueue() = default;
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    /// Producer: the slot to render the next frame into.
+    T& back() noexcept { return slots_[back_].frame; }
+
+    /// Producer: publishes `back()`, to be sent no later than `deadline`.
+    void publish(std::uint64_t deadline = ~std::uint64_t(0)) noexcept
+    {
+        slots_[back_].deadline = deadline;
+        const std::uint8_t prev =
+            middle_.exchange(std::uint8_t(back_ | fresh_bit), std::memory_order_acq_rel);
+        if (prev & fresh_bit)
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        back_ = prev & index_mask;
+        published_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Consumer: takes the newest published frame, if one arrived since the
+    /// last call, and returns it; otherwise returns nullptr. The returned
+    /// frame stays valid until the next successful acquire().
+    T* acquire(std::uint64_t now = 0) noexcept
+    {
+        if (!(middle_.load(std::memory_order_relaxed) & fresh_bit))
+            return nullptr;
+        const std::uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & index_mask;
+        if (now > slots_[front_].deadline)
+            late_.fetch_add(1, std::memory_order_relaxed);
+        return &slots_[front_].frame;
+    }
+
+    /// Consumer: the frame returned by the last successful acquire().
+    T& front() noexcept { return slots_[front_].frame; }
+
+    std::uint32_t published() const noexcept { return published_.load(std::memory_order_relaxed); }
+    /// Frames overwritten before the consumer picked them up.
+    std::uint32_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+    /// Frames picked up after their deadline.
+    std::uint32_t late() const noexcept { return late_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::uint8_t index_mask = 0x3;
+    static constexpr std::uint8_t fresh_bit = 0x4;
+
+    struct alignas(64) Slot {
+        T frame{};
+        std::uint64_t deadline = 0;
+    };
+
+    Slot slots_[3];
+    alignas(64) std::uint8_t back_ = 0;       // producer only
+    alignas(64) std::uint8_t front_ = 1;      // consumer only
+    alignas(64) std::atomic<std::uint8_t> middle_{2};
+    std::atomic<std::uint32_t> published_{0};
+    std::atomic<std::uint32_t> dropped_{0};
+    std::atomic<std::uint32_t> late_{0};
+};
+
+} // namespace ws2812b
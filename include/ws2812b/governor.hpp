@@ -0,0 +1,96 @@
+// Frame-rate governor: paces frame production to what the line carries.
+#pragma once
+
+#include "channel_config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// Hands out frame slots no closer together than the channel's wire time
+/// (or a slower target rate), so the application does not render frames
+/// the line could never carry. Time is in nanoseconds of any monotonic
+/// clock the caller chooses.
+///
+/// Typical loop:
+///
+///     if (governor.poll(now_ns())) { render(); submit(); }
+///     else sleep_for(governor.wait_ns(now_ns()));
+class FrameGovernor {
+public:
+    /// `target_fps` of 0 runs at the line's maximum rate.
+    explicit FrameGovernor(const ChannelConfig& channel, double target_fps = 0)
+    {
+        configure(channel, target_fps);
+    }
+
+    /// Paces a group of channels sent in parallel by its longest member.
+    FrameGovernor(const ChannelConfig* channels, std::size_t n, double target_fps = 0)
+    {
+        ChannelConfig longest{};
+        for (std::size_t i = 0; i < n; ++i)
+            if (i == 0 || channels[i].frame_ns() > longest.frame_ns())
+                longest = channels[i];
+        configure(longest, target_fps);
+    }
+
+    /// Re-derives the period, e.g. after the reset gap was calibrated.
+    void configure(const ChannelConfig& channel, double target_fps = 0) noexcept
+    {
+        wire_ns_ = channel.frame_ns();
+        period_ns_ = wire_ns_;
+        if (target_fps > 0) {
+            const auto target = std::uint64_t(1e9 / target_fps);
+            if (target > period_ns_)
+                period_ns_ = target;
+        }
+    }
+
+    std::uint64_t period_ns() const noexcept { return period_ns_; }
+    std::uint64_t wire_ns() const noexcept { return wire_ns_; }
+    double max_fps() const noexcept { return 1e9 / double(wire_ns_); }
+    double fps() const noexcept { return 1e9 / double(period_ns_); }
+
+    /// True if a frame slot is open at `now`; the slot is then taken. Slots
+    /// that passed unused since the last call count as deadline misses.
+    bool poll(std::uint64_t now) noexcept
+    {
+        if (!started_) {
+            started_ = true;
+            next_ = now;
+        }
+        if (now < next_)
+            return false;
+        const std::uint64_t missed = (now - next_) / period_ns_;
+        deadline_misses_ += missed;
+        next_ += (missed + 1) * period_ns_;
+        ++frames_;
+        return true;
+    }
+
+    /// Time until the next slot opens; 0 if one is open.
+    std::uint64_t wait_ns(std::uint64_t now) const noexcept
+    {
+        return started_ && now < next_ ? next_ - now : 0;
+    }
+
+    std::uint64_t next_slot() const noexcept { return next_; }
+
+    /// Frame slots granted.
+    std::uint64_t frames() const noexcept { return frames_; }
+    /// Slots that elapsed without a frame because the application was late.
+    std::uint64_t deadline_misses() const noexcept { return deadline_misses_; }
+
+    void reset_counters() noexcept { frames_ = deadline_misses_ = 0; }
+
+private:
+    std::uint64_t wire_ns_ = 0;
+    std::uint64_t period_ns_ = 1;
+    std::uint64_t next_ = 0;
+    bool started_ = false;
+    std::uint64_t frames_ = 0;
+    std::uint64_t deadline_misses_ = 0;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,105 @@
+// Output-rate interpolation between low-rate content frames.
+//
+// Content arriving at 20-30 fps is blended towards each new frame over
+// the interval the previous frames took to arrive, and sent at whatever
+// rate the FrameGovernor allows. The blend runs inside
+// DitheringEncoder::encode_blend_linear(), fused with colour correction
+// and dithering. The cost is one content interval of latency, and one pass
+// per content frame (not per output frame) that copies it, so the frame
+// queue can recycle it, and records the output at that moment as the new
+// start of the blend.
+#pragma once
+
+#include "dither.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ws2812b {
+
+/// Blend phase from content-frame arrival times: 0 at the arrival of the
+/// newest frame, 256 one measured interval later. Time is the caller's ns.
+class KeyframeClock {
+public:
+    /// `max_interval_ns` bounds the interval after a stall, so the next
+    /// frame after a pause fades in at most that slowly.
+    explicit KeyframeClock(std::uint64_t max_interval_ns = 200000000) noexcept
+        : max_interval_(max_interval_ns)
+    {
+    }
+
+    void keyframe(std::uint64_t now) noexcept
+    {
+        if (frames_ != 0) {
+            const std::uint64_t d = now - last_;
+            interval_ = d < max_interval_ ? d : max_interval_;
+        }
+        last_ = now;
+        ++frames_;
+    }
+
+    /// Fraction of the way from the previous to the newest frame, out of 256.
+    std::uint32_t phase(std::uint64_t now) const noexcept
+    {
+        if (interval_ == 0 || now - last_ >= interval_)
+            return 256;
+        return std::uint32_t((now - last_) * 256 / interval_);
+    }
+
+    std::uint64_t interval_ns() const noexcept { return interval_; }
+    std::uint64_t keyframes() const noexcept { return frames_; }
+
+private:
+    std::uint64_t max_interval_;
+    std::uint64_t last_ = 0;
+    std::uint64_t interval_ = 0;
+    std::uint64_t frames_ = 0;
+};
+
+/// Blends from the output shown when the newest content frame arrived
+/// towards that frame. The start is kept as corrected values, so a frame
+/// arriving before the previous blend finished fades on from where the
+/// output was instead of jumping back to the previous frame.
+template <typename ChipT, typename Format, typename Pixel = Rgb>
+class Interpolator {
+public:
+    using unit_type = typename Format::unit_type;
+
+    explicit Interpolator(std::size_t pixels, const ColorCorrection& c = ColorCorrection{},
+                          std::uint64_t max_interval_ns = 200000000)
+        : from_(new std::uint16_t[pixels * ChipT::channels]()),
+          to_(new Pixel[pixels]()),
+          pixels_(pixels),
+          encoder_(pixels, c),
+          clock_(max_interval_ns)
+    {
+    }
+
+    /// A new content frame arrived at `now`.
+    void push(const Pixel* frame, std::uint64_t now) noexcept
+    {
+        encoder_.blend_linear(from_.get(), to_.get(), clock_.phase(now), pixels_);
+        std::memcpy(to_.get(), frame, pixels_ * sizeof(Pixel));
+        clock_.keyframe(now);
+    }
+
+    /// Encodes the output frame for `now`; call at the governor's rate.
+    unit_type* encode(std::uint64_t now, unit_type* out)
+    {
+        return encoder_.encode_blend_linear(from_.get(), to_.get(), clock_.phase(now), pixels_, out);
+    }
+
+    DitheringEncoder<ChipT, Format>& encoder() noexcept { return encoder_; }
+    const KeyframeClock& clock() const noexcept { return clock_; }
+
+private:
+    std::unique_ptr<std::uint16_t[]> from_;
+    std::unique_ptr<Pixel[]> to_;
+    std::size_t pixels_;
+    DitheringEncoder<ChipT, Format> encoder_;
+    KeyframeClock clock_;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,258 @@
+// Frame verification from the end of the cascade, without readback.
+//
+// Every pixel latches the first 24 bits it receives and regenerates the
+// rest for the next, so the last pixel's DOUT carries only what was sent
+// beyond the chain. Each frame therefore ends in a short probe after the
+// last pixel. The probe carries a sequence number, a rotating sample of the
+// frame's bytes and a check word. Every pixel in turn has to decode and
+// re-time the probe under the same timing as its own data. A probe that
+// comes back intact shows the chain is reading the line correctly. A
+// damaged, missing or unexpected probe flags the frame.
+//
+// The transmit side only builds the 12-byte probe and records its hash.
+// A capture input on DOUT hands over edge timestamps from its ISR or DMA
+// callback. Decoding and comparison run in poll(), on whatever core has
+// time to spare, so the output path never waits for the check.
+#pragma once
+
+#include "timing.hpp"
+#include "waveform.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ws2812b {
+
+/// Wire bytes appended after the last pixel: 4 RGB or 3 RGBW pixels.
+inline constexpr std::size_t probe_bytes = 12;
+
+class LoopbackVerifier {
+public:
+    /// `t` is the timing the chain's last pixel regenerates, normally the
+    /// datasheet's. `edge_capacity` and `history` (probes awaiting their
+    /// echo) are rounded up to powers of two.
+    explicit LoopbackVerifier(const Timing& t = ws2812b_timing, std::size_t edge_capacity = 4096,
+                              std::size_t history = 64)
+        : timing_(t),
+          gap_ns_(4 * t.bit_ns()),
+          edge_mask_(round_up(edge_capacity) - 1),
+          expected_mask_(round_up(history) - 1),
+          edges_(new Edge[edge_mask_ + 1]),
+          expected_(new std::atomic<std::uint64_t>[expected_mask_ + 1])
+    {
+        for (std::size_t i = 0; i <= expected_mask_; ++i)
+            expected_[i].store(~std::uint64_t(0), std::memory_order_relaxed);
+    }
+
+    // Transmit side.
+
+    /// Writes the probe for the frame of `bytes` wire-order bytes at
+    /// `wire` into `out[probe_bytes]`. Encode it right after the frame
+    /// (encode_bytes<Format>) and before the RET padding.
+    void probe(const std::uint8_t* wire, std::size_t bytes, std::uint8_t* out) noexcept
+    {
+        const std::uint32_t seq = seq_++;
+        put32(out, seq);
+        for (std::size_t k = 0; k < 4; ++k)
+            out[4 + k] = bytes ? wire[(std::size_t(seq) * 4 + k) % bytes] : 0;
+        put32(out + 8, fnv(out, 8));
+        expected_[seq & expected_mask_].store(std::uint64_t(seq) << 32 | fnv(out, probe_bytes),
+                                              std::memory_order_release);
+        sent_.store(seq_, std::memory_order_relaxed);
+    }
+
+    // Capture side: ISR or DMA callback.
+
+    /// Queues captured DOUT edges, in capture order. Returns false and
+    /// counts an overrun, dropping the batch, if poll() has fallen behind.
+    /// An edge at the level the line already has only says it stayed
+    /// there: queue Edge{t, false} once the line is known idle, e.g. at
+    /// transfer completion, to end the last probe without waiting for the
+    /// next frame.
+    bool capture(const Edge* edges, std::size_t n) noexcept
+    {
+        const std::uint64_t head = edge_head_.load(std::memory_order_relaxed);
+        if (head + n - edge_tail_.load(std::memory_order_acquire) > edge_mask_ + 1) {
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            edges_[(head + i) & edge_mask_] = edges[i];
+        edge_head_.store(head + n, std::memory_order_release);
+        return true;
+    }
+
+    // Checking side: one thread at a time, which also reads the counters.
+
+    /// Decodes the queued edges and checks every completed probe. A probe
+    /// is complete once an edge at least 4 bit periods after its last bit
+    /// has been captured: the start of the next frame's probe, or an idle
+    /// mark. Returns the number of probes checked.
+    std::size_t poll() noexcept
+    {
+        const std::uint64_t head = edge_head_.load(std::memory_order_acquire);
+        std::uint64_t tail = edge_tail_.load(std::memory_order_relaxed);
+        const std::uint64_t before = checked();
+        for (; tail != head; ++tail) {
+            const Edge e = edges_[tail & edge_mask_];
+            if (have_edge_ && e.level == last_.level) {
+                // Still at the same level; the run goes on from last_.
+                if (!e.level && e.t_ps >= last_.t_ps && (e.t_ps - last_.t_ps + 500) / 1000 >= gap_ns_)
+                    end_probe();
+                continue;
+            }
+            if (have_edge_ && e.t_ps > last_.t_ps)
+                run(last_.level, e.t_ps - last_.t_ps);
+            last_ = e;
+            have_edge_ = true;
+        }
+        edge_tail_.store(tail, std::memory_order_release);
+        return std::size_t(checked() - before);
+    }
+
+    /// Probes built by probe().
+    std::uint32_t sent() const noexcept { return sent_.load(std::memory_order_relaxed); }
+    /// Probes that came back exactly as sent.
+    std::uint64_t verified() const noexcept { return verified_; }
+    /// Probes that came back with the wrong bits.
+    std::uint64_t mismatched() const noexcept { return mismatched_; }
+    /// Probes with pulse widths outside the windows or the wrong bit count.
+    std::uint64_t garbled() const noexcept { return garbled_; }
+    /// Probes that never came back, e.g. lost to a capture overrun.
+    std::uint64_t missed() const noexcept { return missed_; }
+    /// Intact probes whose record was already overwritten, or never made.
+    std::uint64_t unmatched() const noexcept { return unmatched_; }
+    std::uint64_t overruns() const noexcept { return overruns_.load(std::memory_order_relaxed); }
+
+    /// Probes that failed in any way.
+    std::uint64_t failures() const noexcept { return mismatched_ + garbled_ + missed_; }
+
+private:
+    static constexpr std::size_t probe_bits = 8 * probe_bytes;
+
+    static std::size_t round_up(std::size_t n) noexcept
+    {
+        std::size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    static void put32(std::uint8_t* p, std::uint32_t v) noexcept
+    {
+        for (int k = 0; k < 4; ++k)
+            p[k] = std::uint8_t(v >> (8 * k));
+    }
+
+    static std::uint32_t get32(const std::uint8_t* p) noexcept
+    {
+        return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 |
+               std::uint32_t(p[3]) << 24;
+    }
+
+    /// FNV-1a.
+    static std::uint32_t fnv(const std::uint8_t* p, std::size_t n) noexcept
+    {
+        std::uint32_t h = 2166136261u;
+        for (std::size_t i = 0; i < n; ++i)
+            h = (h ^ p[i]) * 16777619u;
+        return h;
+    }
+
+    std::uint64_t checked() const noexcept { return verified_ + mismatched_ + unmatched_; }
+
+    /// One run of the line at `level` for `ps`.
+    void run(bool level, std::uint64_t ps) noexcept
+    {
+        const std::uint64_t ns = (ps + 500) / 1000;
+        if (!level) {
+            if (ns >= gap_ns_)
+                end_probe();
+            return;
+        }
+        const auto within = [&](std::uint32_t nominal) {
+            return ns + timing_.tolerance_ns >= nominal && ns <= nominal + timing_.tolerance_ns;
+        };
+        const bool one = ns >= (timing_.t0h_ns + timing_.t1h_ns) / 2;
+        if (!within(one ? timing_.t1h_ns : timing_.t0h_ns))
+            bad_ = true;
+        if (bits_ < probe_bits) {
+            auto& byte = rx_[bits_ / 8];
+            byte = std::uint8_t(byte << 1 | unsigned(one));
+            ++bits_;
+        } else {
+            bad_ = true; // longer than a probe
+        }
+    }
+
+    /// A probe is judged only once the gap after it shows it has ended, so
+    /// an over-long one is counted as garbled and never also checked.
+    void end_probe() noexcept
+    {
+        if (bits_ == probe_bits && !bad_) {
+            check();
+        } else if (bits_ != 0) {
+            ++garbled_;
+            ++damaged_;
+        }
+        bits_ = 0;
+        bad_ = false;
+    }
+
+    void check() noexcept
+    {
+        const std::uint32_t seq = get32(rx_);
+        if (fnv(rx_, 8) != get32(rx_ + 8)) {
+            ++mismatched_;
+            ++damaged_;
+            return; // the sequence number cannot be trusted either
+        }
+        // Damaged probes since the last intact one account for part of the gap.
+        const std::uint32_t gap = seq - last_seq_ - 1;
+        if (have_seq_ && gap < 0x80000000u && gap > damaged_)
+            missed_ += gap - damaged_;
+        damaged_ = 0;
+        have_seq_ = true;
+        last_seq_ = seq;
+        const std::uint64_t e = expected_[seq & expected_mask_].load(std::memory_order_acquire);
+        if (std::uint32_t(e >> 32) != seq || e == ~std::uint64_t(0))
+            ++unmatched_;
+        else if (std::uint32_t(e) != fnv(rx_, probe_bytes))
+            ++mismatched_;
+        else
+            ++verified_;
+    }
+
+    const Timing timing_;
+    const std::uint32_t gap_ns_; ///< a low this long ends a probe
+    const std::size_t edge_mask_;
+    const std::size_t expected_mask_;
+    std::unique_ptr<Edge[]> edges_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> expected_; ///< seq << 32 | probe hash
+
+    std::uint32_t seq_ = 0; // transmit side only
+    std::atomic<std::uint32_t> sent_{0};
+
+    alignas(64) std::atomic<std::uint64_t> edge_head_{0};
+    std::atomic<std::uint64_t> overruns_{0};
+    alignas(64) std::atomic<std::uint64_t> edge_tail_{0};
+
+    // Checking side only.
+    Edge last_{0, false};
+    bool have_edge_ = false;
+    std::uint8_t rx_[probe_bytes] = {};
+    std::size_t bits_ = 0;
+    bool bad_ = false;
+    bool have_seq_ = false;
+    std::uint32_t last_seq_ = 0;
+    std::uint32_t damaged_ = 0;
+    std::uint64_t verified_ = 0;
+    std::uint64_t mismatched_ = 0;
+    std::uint64_t garbled_ = 0;
+    std::uint64_t missed_ = 0;
+    std::uint64_t unmatched_ = 0;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,55 @@
+// Table-driven encoder from wire-order bytes to peripheral symbols.
+#pragma once
+
+#include "pixel.hpp"
+#include "symbol_format.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+namespace ws2812b {
+
+/// Units needed to encode `pixels` pixels, without reset padding.
+template <typename Format>
+constexpr std::size_t encoded_units(std::size_t pixels) noexcept
+{
+    return pixels * 3 * Format::units_per_byte;
+}
+
+/// Encodes `n` wire-order bytes into `out` with one table lookup per byte.
+/// Returns one past the last unit written.
+template <typename Format>
+inline typename Format::unit_type* encode_bytes(const std::uint8_t* in, std::size_t n,
+                                                typename Format::unit_type* out) noexcept
+{
+    constexpr std::size_t step = Format::units_per_byte;
+    for (std::size_t i = 0; i < n; ++i, out += step)
+        std::memcpy(out, Format::table[in[i]].data(), sizeof(typename Format::unit_type) * step);
+    return out;
+}
+
+/// Encodes `n` pixels in G, R, B order.
+template <typename Format>
+inline typename Format::unit_type* encode_pixels(const Grb* px, std::size_t n,
+                                                 typename Format::unit_type* out) noexcept
+{
+    return encode_bytes<Format>(reinterpret_cast<const std::uint8_t*>(px), n * 3, out);
+}
+
+/// Fills `n` units with line-low symbols, e.g. for RET padding.
+template <typename Format>
+inline typename Format::unit_type* encode_idle(std::size_t n,
+                                               typename Format::unit_type* out) noexcept
+{
+    constexpr auto idle = detail::idle_of<Format>::value;
+    if constexpr (idle == 0) {
+        std::memset(out, 0, n * sizeof(typename Format::unit_type));
+        return out + n;
+    } else {
+        for (std::size_t i = 0; i < n; ++i)
+            *out++ = idle;
+        return out;
+    }
+}
+
+} // namespace ws2812b
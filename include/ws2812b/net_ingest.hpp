@@ -0,0 +1,351 @@
+// E1.31 (sACN), Art-Net and DDP ingest into transmit frames.
+//
+// Parsing is header inspection only: a Packet points into the datagram it
+// came from. UniverseAssembler then copies each payload once, straight into
+// the frame being filled, reordering RGB to the frame's pixel type on the
+// way; frames are committed on the sync packet when the sender uses sync,
+// on the DDP push flag, or otherwise when every universe has arrived.
+#pragma once
+
+#include "pixel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ws2812b {
+
+constexpr std::uint16_t e131_port = 5568;
+constexpr std::uint16_t artnet_port = 6454;
+constexpr std::uint16_t ddp_port = 4048;
+
+enum class Protocol : std::uint8_t { unknown, e131, artnet, ddp };
+
+enum class PacketKind : std::uint8_t { invalid, data, sync };
+
+/// One parsed datagram. `data` points into the datagram.
+struct Packet {
+    PacketKind kind = PacketKind::invalid;
+    Protocol protocol = Protocol::unknown;
+    /// E1.31 universe or Art-Net port address; unused for DDP.
+    std::uint16_t universe = 0;
+    /// E1.31: the universe whose sync packet commits this data (0 = none);
+    /// on a sync packet, its own sync address.
+    std::uint16_t sync_address = 0;
+    std::uint8_t sequence = 0;
+    /// DDP: commit after this packet.
+    bool push = false;
+    /// DDP: byte offset of `data` in the frame.
+    std::uint32_t offset = 0;
+    const std::uint8_t* data = nullptr;
+    std::size_t length = 0;
+};
+
+namespace detail {
+
+inline std::uint16_t be16(const std::uint8_t* p) noexcept
+{
+    return std::uint16_t(p[0] << 8 | p[1]);
+}
+
+inline std::uint32_t be32(const std::uint8_t* p) noexcept
+{
+    return std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | p[3];
+}
+
+inline void store_rgb(Grb& px, const std::uint8_t* s) noexcept { px = Grb{s[1], s[0], s[2]}; }
+inline void store_rgb(Rgb& px, const std::uint8_t* s) noexcept { px = Rgb{s[0], s[1], s[2]}; }
+
+/// Channel `c` (0 = red) of a pixel stored by store_rgb().
+inline std::uint8_t& channel_of(Grb& px, unsigned c) noexcept
+{
+    return c == 0 ? px.r : c == 1 ? px.g : px.b;
+}
+inline std::uint8_t& channel_of(Rgb& px, unsigned c) noexcept
+{
+    return c == 0 ? px.r : c == 1 ? px.g : px.b;
+}
+
+} // namespace detail
+
+/// ANSI E1.31-2018 data (root vector 4) and universe sync (root vector 8)
+/// packets. Preview data and non-zero start codes are ignored.
+inline Packet parse_e131(const std::uint8_t* d, std::size_t n) noexcept
+{
+    static const std::uint8_t acn_id[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+    Packet p;
+    if (n < 49 || detail::be16(d) != 0x0010 || std::memcmp(d + 4, acn_id, 12) != 0)
+        return p;
+    const std::uint32_t root = detail::be32(d + 18);
+    const std::uint32_t framing = detail::be32(d + 40);
+    p.protocol = Protocol::e131;
+    if (root == 0x08 && framing == 0x01) {
+        p.kind = PacketKind::sync;
+        p.sequence = d[44];
+        p.sync_address = detail::be16(d + 45);
+        return p;
+    }
+    if (root != 0x04 || framing != 0x02 || n < 126)
+        return p;
+    const std::uint8_t options = d[112];
+    const std::size_t values = detail::be16(d + 123);
+    if ((options & 0x80) || d[117] != 0x02 || values < 1 || 125 + values > n || d[125] != 0)
+        return p;
+    p.kind = PacketKind::data;
+    p.sync_address = detail::be16(d + 109);
+    p.sequence = d[111];
+    p.universe = detail::be16(d + 113);
+    p.data = d + 126;
+    p.length = values - 1;
+    return p;
+}
+
+/// Art-Net 4 ArtDmx and ArtSync. The universe is the 15-bit port address.
+inline Packet parse_artnet(const std::uint8_t* d, std::size_t n) noexcept
+{
+    Packet p;
+    if (n < 14 || std::memcmp(d, "Art-Net", 8) != 0)
+        return p;
+    const std::uint16_t opcode = std::uint16_t(d[8] | d[9] << 8);
+    p.protocol = Protocol::artnet;
+    if (opcode == 0x5200) {
+        p.kind = PacketKind::sync;
+        return p;
+    }
+    if (opcode != 0x5000 || n < 18)
+        return p;
+    const std::size_t length = detail::be16(d + 16);
+    if (18 + length > n)
+        return p;
+    p.kind = PacketKind::data;
+    p.sequence = d[12];
+    p.universe = std::uint16_t((d[15] & 0x7F) << 8 | d[14]);
+    p.data = d + 18;
+    p.length = length;
+    return p;
+}
+
+/// DDP data packets for the default output (id 1). Queries, replies and
+/// status/config ids are ignored.
+inline Packet parse_ddp(const std::uint8_t* d, std::size_t n) noexcept
+{
+    Packet p;
+    if (n < 10 || (d[0] & 0xC0) != 0x40 || (d[0] & 0x06) != 0 || d[3] != 1)
+        return p;
+    const std::size_t header = (d[0] & 0x10) ? 14 : 10;
+    const std::size_t length = detail::be16(d + 8);
+    if (header + length > n)
+        return p;
+    p.protocol = Protocol::ddp;
+    p.kind = PacketKind::data;
+    p.sequence = d[1] & 0x0F;
+    p.push = (d[0] & 0x01) != 0;
+    p.offset = detail::be32(d + 4);
+    p.data = d + header;
+    p.length = length;
+    return p;
+}
+
+/// Detects the protocol from the packet itself, so one socket per port or
+/// one shared handler both work.
+inline Packet parse_packet(const std::uint8_t* d, std::size_t n) noexcept
+{
+    if (n >= 8 && d[0] == 'A' && d[1] == 'r')
+        return parse_artnet(d, n);
+    if (n >= 16 && d[0] == 0x00 && d[1] == 0x10)
+        return parse_e131(d, n);
+    return parse_ddp(d, n);
+}
+
+/// How DMX universes map onto the frame: universe `first_universe` starts
+/// at pixel 0 and each universe carries `pixels_per_universe` RGB pixels.
+struct UniverseMap {
+    std::uint16_t first_universe = 1;
+    std::uint16_t pixels_per_universe = 170;
+};
+
+/// Assembles packets into frames of `Pixel` (Grb for DirtyFrame and the
+/// plain encoders, Rgb for the chip-aware ones).
+///
+/// feed() writes into the frame last returned by `commit`/bind() and calls
+/// `commit()` when that frame is complete; `commit` publishes it (e.g.
+/// FrameQueue::publish()) and returns the next frame to fill. Pixels of
+/// universes that did not arrive keep whatever the new frame held.
+///
+/// Sync mode starts with the first E1.31 packet naming a sync address or
+/// the first ArtSync, and ends after `sync_timeout_ns` without a sync
+/// packet (the Art-Net 4 rule, applied to both), even if data naming the
+/// address keeps arriving; it resumes with the next sync packet. Outside
+/// sync mode a frame commits once every universe has arrived, or early
+/// when a universe repeats, which means the sender has moved on to the
+/// next frame.
+template <typename Pixel = Grb>
+class UniverseAssembler {
+public:
+    static constexpr std::uint64_t sync_timeout_ns = 4000000000u;
+
+    UniverseAssembler(std::size_t pixels, UniverseMap map = {})
+        : pixels_(pixels),
+          map_(map),
+          universes_((pixels + map.pixels_per_universe - 1) / map.pixels_per_universe),
+          seen_(new std::uint32_t[universes_ ? universes_ : 1]()),
+          last_seq_(new std::uint8_t[universes_ ? universes_ : 1]()),
+          have_seq_(new bool[universes_ ? universes_ : 1]())
+    {
+    }
+
+    /// Sets the frame to fill until the first commit.
+    void bind(Pixel* frame) noexcept { frame_ = frame; }
+
+    std::size_t universes() const noexcept { return universes_; }
+    bool sync_mode() const noexcept { return e131_sync_ || artnet_sync_; }
+
+    template <typename Commit>
+    void feed(const Packet& p, std::uint64_t now_ns, Commit&& commit)
+    {
+        if (sync_mode() && now_ns - last_sync_ns_ > sync_timeout_ns) {
+            // The sync source is gone; data naming its address no longer
+            // restarts sync mode until a sync packet does.
+            sync_lost_ = e131_sync_;
+            e131_sync_ = false;
+            artnet_sync_ = false;
+        }
+        if (p.kind == PacketKind::sync) {
+            if (p.protocol == Protocol::artnet) {
+                artnet_sync_ = true;
+            } else {
+                if (sync_address_ == 0 || p.sync_address != sync_address_)
+                    return;
+                e131_sync_ = true;
+                sync_lost_ = false;
+            }
+            last_sync_ns_ = now_ns;
+            if (received_ != 0)
+                commit_frame(commit, received_ >= universes_);
+            return;
+        }
+        if (p.kind != PacketKind::data || !frame_)
+            return;
+        ++packets_;
+        if (p.protocol == Protocol::ddp) {
+            store_bytes(p.offset, p.data, p.length);
+            ++received_;
+            if (p.push)
+                commit_frame(commit, true);
+            return;
+        }
+        if (p.universe < map_.first_universe || std::size_t(p.universe - map_.first_universe) >= universes_) {
+            ++ignored_;
+            return;
+        }
+        const std::size_t u = p.universe - map_.first_universe;
+        if (stale(u, p.sequence, p.protocol == Protocol::artnet)) {
+            ++out_of_order_;
+            return;
+        }
+        if (p.protocol == Protocol::e131 && p.sync_address != 0) {
+            if (p.sync_address != sync_address_) {
+                sync_address_ = p.sync_address;
+                sync_lost_ = false;
+            }
+            // Only sync packets refresh the timeout; this starts it.
+            if (!e131_sync_ && !sync_lost_) {
+                e131_sync_ = true;
+                last_sync_ns_ = now_ns;
+            }
+        }
+        // In free-running mode a repeat starts the next frame.
+        if (seen_[u] == generation_ && !sync_mode())
+            commit_frame(commit, false);
+        const std::size_t first = u * map_.pixels_per_universe;
+        store_bytes(std::uint32_t(first * 3), p.data,
+                    p.length < map_.pixels_per_universe * 3u ? p.length : map_.pixels_per_universe * 3u);
+        if (seen_[u] != generation_) {
+            seen_[u] = generation_;
+            ++received_;
+        }
+        if (!sync_mode() && received_ == universes_)
+            commit_frame(commit, true);
+    }
+
+    /// Data packets accepted.
+    std::uint32_t packets() const noexcept { return packets_; }
+    std::uint32_t frames() const noexcept { return frames_; }
+    /// Frames committed before all universes arrived.
+    std::uint32_t incomplete() const noexcept { return incomplete_; }
+    /// Packets dropped by the sequence check.
+    std::uint32_t out_of_order() const noexcept { return out_of_order_; }
+    /// Packets for universes outside the map.
+    std::uint32_t ignored() const noexcept { return ignored_; }
+
+private:
+    /// E1.31 6.7.2: a packet whose sequence is 1..20 behind the last one
+    /// is stale. Art-Net sequence 0 means the sender does not set it. The
+    /// first packet of a universe is always accepted, whatever its sequence.
+    bool stale(std::size_t u, std::uint8_t seq, bool zero_disables) noexcept
+    {
+        const int delta = std::int8_t(std::uint8_t(seq - last_seq_[u]));
+        if (have_seq_[u] && !(zero_disables && seq == 0) && delta <= 0 && delta > -20)
+            return true;
+        last_seq_[u] = seq;
+        have_seq_[u] = true;
+        return false;
+    }
+
+    void store_bytes(std::uint32_t offset, const std::uint8_t* src, std::size_t n) noexcept
+    {
+        const std::size_t limit = pixels_ * 3;
+        if (offset >= limit)
+            return;
+        if (n > limit - offset)
+            n = limit - offset;
+        std::size_t px = offset / 3;
+        unsigned ch = offset % 3;
+        for (; ch != 0 && n != 0; --n, ++src) {
+            detail::channel_of(frame_[px], ch) = *src;
+            if (++ch == 3) {
+                ch = 0;
+                ++px;
+            }
+        }
+        for (; n >= 3; n -= 3, src += 3)
+            detail::store_rgb(frame_[px++], src);
+        for (; n != 0; --n, ++src)
+            detail::channel_of(frame_[px], ch++) = *src;
+    }
+
+    template <typename Commit>
+    void commit_frame(Commit& commit, bool complete)
+    {
+        if (!complete)
+            ++incomplete_;
+        ++frames_;
+        received_ = 0;
+        ++generation_;
+        frame_ = commit();
+    }
+
+    std::size_t pixels_;
+    UniverseMap map_;
+    std::size_t universes_;
+    std::unique_ptr<std::uint32_t[]> seen_;
+    std::unique_ptr<std::uint8_t[]> last_seq_;
+    std::unique_ptr<bool[]> have_seq_;
+    Pixel* frame_ = nullptr;
+    std::uint32_t generation_ = 1;
+    std::size_t received_ = 0;
+    std::uint16_t sync_address_ = 0;
+    bool e131_sync_ = false;
+    bool sync_lost_ = false;
+    bool artnet_sync_ = false;
+    std::uint64_t last_sync_ns_ = 0;
+
+    std::uint32_t packets_ = 0;
+    std::uint32_t frames_ = 0;
+    std::uint32_t incomplete_ = 0;
+    std::uint32_t out_of_order_ = 0;
+    std::uint32_t ignored_ = 0;
+};
+
+} // namespace ws2812b
@@ -0,0 +1,108 @@
+// Indexed frames: one byte per pixel into a palette of up to 256 colours.
+//
+// Much content (effects, UI, mapped video at low colour depth) uses fewer
+// than 256 colours. An indexed frame holds one palette index per pixel, a
+// third of an Rgb frame. The palette is kept already encoded: each entry
+// holds the wire symbols of one pixel of `ChipT`, in its channel order and
+// after any correction applied to the colour. Expanding an index is then
+// one copy, so encoding is no slower than encode_chip(). With a
+// StreamingEncoder the indices are expanded only in each DMA refill, and
+// no full-colour frame exists anywhere.
+#pragma once
+
+#include "arena.hpp"
+#include "chip_encoder.hpp"
+#include "pixel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ws2812b {
+
+/// Encoded colours of `ChipT` in `Format`, addressed by an 8-bit index.
+template <typename ChipT, typename Format>
+class Palette {
+public:
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t units_per_pixel = ChipT::channels * Format::units_per_byte;
+    static constexpr std::size_t max_colours = 256;
+
+    /// A palette of `colours` entries (at most 256), all black. Indices
+    /// handed to the encoders must be below colours().
+    explicit Palette(std::size_t colours = max_colours)
+        : colours_(clamp(colours)), owned_(new unit_type[colours_ * units_per_pixel])
+    {
+        symbols_ = owned_.get();
+        clear();
+    }
+
+    Palette(Arena& arena, std::size_t colours = max_colours, std::size_t align = 4)
+        : colours_(clamp(colours)), symbols_(arena.allocate<unit_type>(colours_ * units_per_pixel, align))
+    {
+        clear();
+    }
+
+    static constexpr ArenaLayout layout(std::size_t colours = max_colours, std::size_t align = 4) noexcept
+    {
+        return ArenaLayout{}.template reserve<unit_type>(clamp(colours) * units_per_pixel, align);
+    }
+
+    Palette(const Palette&) = delete;
+    Palette& operator=(const Palette&) = delete;
+
+    std::size_t colours() const noexcept { return colours_; }
+
+    /// Encodes `c` (Rgb, Rgbw or as for encode_chip()) as entry `index`.
+    template <typename Pixel>
+    void set(std::uint8_t index, const Pixel& c) noexcept
+    {
+        if (index < colours_)
+            encode_chip<ChipT, Format>(&c, 1, symbols_ + index * units_per_pixel);
+    }
+
+    /// Entries [0, n) from `colours`.
+    template <typename Pixel>
+    void assign(const Pixel* colours, std::size_t n) noexcept
+    {
+        encode_chip<ChipT, Format>(colours, n < colours_ ? n : colours_, symbols_);
+    }
+
+    void clear() noexcept
+    {
+        const Rgbw black{};
+        for (std::size_t i = 0; i < colours_; ++i)
+            encode_chip<ChipT, Format>(&black, 1, symbols_ + i * units_per_pixel);
+    }
+
+    /// The units_per_pixel symbols of entry `index`.
+    const unit_type* symbols(std::uint8_t index) const noexcept
+    {
+        return symbols_ + index * units_per_pixel;
+    }
+
+private:
+    static constexpr std::size_t clamp(std::size_t colours) noexcept
+    {
+        return colours < max_colours ? colours : max_colours;
+    }
+
+    std::size_t colours_;
+    std::unique_ptr<unit_type[]> owned_;
+    unit_type* symbols_ = nullptr;
+};
+
+/// Encodes `n` palette indices; the indexed counterpart of encode_chip().
+template <typename ChipT, typename Format>
+inline typename Format::unit_type* encode_indexed(const std::uint8_t* indices, std::size_t n,
+                                                  const Palette<ChipT, Format>& palette,
+                                                  typename Format::unit_type* out) noexcept
+{
+    constexpr std::size_t step = Palette<ChipT, Format>::units_per_pixel;
+    for (std::size_t i = 0; i < n; ++i, out += step)
+        std::memcpy(out, palette.symbols(indices[i]), sizeof(typename Format::unit_type) * step);
+    return out;
+}
+
+} // namespace ws2812b
@@ -0,0 +1,152 @@
+// Parallel output: up to 32 strips clocked out at once on one GPIO port.
+//
+// Every data bit becomes three port writes at 2.4 MHz (416ns each): all
+// active lines high, then the bit of every channel, then all lines low. A
+// channel holding a 0 therefore sees 417ns high / 833ns low, a 1 sees
+// 833ns high / 417ns low, the same waveform as Spi3. Port bit `c` drives
+// channel `c`, so the word stream is written by DMA to the port output
+// register at the 2.4 MHz slot rate.
+#pragma once
+
+#include "pixel.hpp"
+#include "timing.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ws2812b {
+
+/// Symbol format of the port word stream, usable with TransmitEngine.
+/// `Word` is std::uint8_t, std::uint16_t or std::uint32_t for 8, 16 or 32
+/// channels.
+template <typename Word>
+struct ParallelWords {
+    static_assert(std::is_unsigned<Word>::value && sizeof(Word) <= 4,
+                  "port word must be an unsigned type of at most 32 bits");
+
+    using unit_type = Word;
+    static constexpr std::size_t channels = sizeof(Word) * 8;
+    static constexpr std::size_t units_per_byte = 8 * 3;
+    static constexpr std::uint32_t slot_hz = 2'400'000;
+    static constexpr std::uint64_t unit_ps = 1'000'000'000'000ull / slot_hz;
+
+    static constexpr std::uint64_t bit_ps = 3 * unit_ps;
+    static constexpr std::uint64_t high_ps(bool one) noexcept { return (one ? 2 : 1) * unit_ps; }
+};
+
+/// One strip of a parallel output.
+struct Strip {
+    const Grb* pixels = nullptr;
+    std::size_t length = 0;
+};
+
+namespace detail {
+
+/// Transposes an 8x8 bit matrix: on return byte `k` holds, in bit `c`, bit
+/// `k` of input byte `c`.
+inline std::uint64_t transpose8(std::uint64_t x) noexcept
+{
+    std::uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+} // namespace detail
+
+/// Units needed for strips of at most `longest` pixels, without reset.
+template <typename Word>
+constexpr std::size_t parallel_units(std::size_t longest) noexcept
+{
+    return longest * 3 * ParallelWords<Word>::units_per_byte;
+}
+
+/// Pixels of the longest of the first `channels` strips.
+inline std::size_t longest_strip(const Strip* strips, std::size_t channels) noexcept
+{
+    std::size_t longest = 0;
+    for (std::size_t c = 0; c < channels; ++c)
+        if (strips[c].length > longest)
+            longest = strips[c].length;
+    return longest;
+}
+
+namespace detail {
+
+/// Bit-transposes pixel `p` of `channels` strips into `bits[24]`: word `k`
+/// holds the k-th wire bit of every channel. Returns the channels that
+/// have a pixel `p`.
+template <typename Word>
+inline Word transpose_pixel(const Strip* strips, std::size_t channels, std::size_t p,
+                            Word* bits) noexcept
+{
+    Word active = 0;
+    for (std::size_t c = 0; c < channels; ++c)
+        if (p < strips[c].length)
+            active |= Word(Word(1) << c);
+
+    for (std::size_t byte = 0; byte < 3; ++byte) {
+        Word* out = bits + 8 * byte;
+        for (std::size_t k = 0; k < 8; ++k)
+            out[k] = 0;
+        for (std::size_t group = 0; group * 8 < channels; ++group) {
+            std::uint64_t rows = 0;
+            for (std::size_t k = 0; k < 8 && group * 8 + k < channels; ++k) {
+                const Strip& s = strips[group * 8 + k];
+                if (p < s.length) {
+                    const auto* wire = reinterpret_cast<const std::uint8_t*>(s.pixels + p);
+                    rows |= std::uint64_t(wire[byte]) << (8 * k);
+                }
+            }
+            // out[k] is the k-th bit sent, i.e. data bit 7 - k.
+            const std::uint64_t cols = transpose8(rows);
+            for (std::size_t k = 0; k < 8; ++k)
+                out[k] |= Word(Word(std::uint8_t(cols >> (8 * (7 - k)))) << (8 * group));
+        }
+    }
+    return active;
+}
+
+} // namespace detail
+
+/// Bit-transposes pixels [first, last) of `channels` strips into `out`,
+/// which points at the words of pixel `first`. Disjoint ranges write
+/// disjoint words, so ranges can be encoded concurrently.
+template <typename Word>
+inline Word* encode_parallel_range(const Strip* strips, std::size_t channels, std::size_t first,
+                                   std::size_t last, Word* out) noexcept
+{
+    constexpr std::size_t max_channels = ParallelWords<Word>::channels;
+    if (channels > max_channels)
+        channels = max_channels;
+
+    for (std::size_t p = first; p < last; ++p) {
+        Word bits[24];
+        const Word active = detail::transpose_pixel(strips, channels, p, bits);
+        for (std::size_t k = 0; k < 24; ++k) {
+            *out++ = active;
+            *out++ = bits[k];
+            *out++ = 0;
+        }
+    }
+    return out;
+}
+
+/// Bit-transposes `channels` strips into one port word stream at `out`.
+/// Channel `c` of the result is port bit `c`; strips shorter than the
+/// longest stay low once their pixels are sent. Returns one past the last
+/// word written, i.e. `out + parallel_units<Word>(longest)`.
+template <typename Word>
+inline Word* encode_parallel(const Strip* strips, std::size_t channels, Word* out) noexcept
+{
+    if (channels > ParallelWords<Word>::channels)
+        channels = ParallelWords<Word>::channels;
+    return encode_parallel_range(strips, channels, 0, longest_strip(strips, channels), out);
+}
+
+} // namespace ws2812b
@@ -0,0 +1,46 @@
+// Pixel types.
+#pragma once
+
+#include <cstdint>
+
+namespace ws2812b {
+
+/// One pixel in the order it is sent on the wire: "Composition of 24bit
+/// data" is G7..G0, R7..R0, B7..B0, high bit first.
+struct Grb {
+    std::uint8_t g;
+    std::uint8_t r;
+    std::uint8_t b;
+};
+
+static_assert(sizeof(Grb) == 3, "Grb must be tightly packed wire bytes");
+
+constexpr bool operator==(Grb a, Grb b) noexcept
+{
+    return a.g == b.g && a.r == b.r && a.b == b.b;
+}
+
+constexpr bool operator!=(Grb a, Grb b) noexcept { return !(a == b); }
+
+/// One pixel in the order most renderers produce it.
+struct Rgb {
+    std::uint8_t r;
+    std::uint8_t g;
+    std::uint8_t b;
+};
+
+static_assert(sizeof(Rgb) == 3, "Rgb must be tightly packed");
+
+/// One pixel of a 4-channel part, in renderer order.
+struct Rgbw {
+    std::uint8_t r;
+    std::uint8_t g;
+    std::uint8_t b;
+    std::uint8_t w;
+};
+
+static_assert(sizeof(Rgbw) == 4, "Rgbw must be tightly packed");
+
+constexpr Grb to_grb(Rgb c) noexcept { return Grb{c.g, c.r, c.b}; }
+
+} // namespace ws2812b
@@ -0,0 +1,178 @@
+// Virtual-to-physical pixel mapping compiled into gather tables.
+//
+// The renderer draws into a canvas of width x height x depth pixels in
+// plain (x, y, z) order. A layout function says where each canvas pixel is
+// wired: which output channel and which position along its cascade. The
+// PixelMap inverts that once into one gather table per channel, listing
+// for each wire position the canvas index to send, so encoders
+// (encode_chip_gather) read the canvas in wire order and no reordered copy
+// of the frame is ever made.
+#pragma once
+
+#include "arena.hpp"
+#include "chip_encoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ws2812b {
+
+/// Where one canvas pixel is wired; `unplaced` for pixels with no LED.
+struct Placement {
+    std::uint32_t channel;
+    std::uint32_t index;
+};
+
+inline constexpr Placement unplaced{~std::uint32_t(0), 0};
+
+class PixelMap {
+public:
+    /// A map for `channels` outputs of `lengths[c]` pixels each, with
+    /// every position initially unmapped.
+    PixelMap(const std::size_t* lengths, std::size_t channels)
+        : owned_offsets_(new std::size_t[channels + 1]), channels_(channels)
+    {
+        offsets_ = owned_offsets_.get();
+        const std::size_t total = set_offsets(lengths);
+        owned_gather_.reset(new std::uint32_t[total]);
+        gather_ = owned_gather_.get();
+        clear();
+    }
+
+    PixelMap(Arena& arena, const std::size_t* lengths, std::size_t channels)
+        : offsets_(arena.allocate<std::size_t>(channels + 1)), channels_(channels)
+    {
+        const std::size_t total = set_offsets(lengths);
+        gather_ = arena.allocate<std::uint32_t>(total, 64);
+        clear();
+    }
+
+    static constexpr ArenaLayout layout(const std::size_t* lengths, std::size_t channels) noexcept
+    {
+        std::size_t total = 0;
+        for (std::size_t c = 0; c < channels; ++c)
+            total += lengths[c];
+        return ArenaLayout{}.reserve<std::size_t>(channels + 1).reserve<std::uint32_t>(total, 64);
+    }
+
+    /// Fills the tables from `layout(x, y, z) -> Placement` over a canvas of
+    /// `width * height * depth` pixels, indexed (z * height + y) * width + x.
+    /// Returns the number of placements that were out of range or landed
+    /// on an already mapped position; those are ignored.
+    template <typename Layout>
+    std::size_t compile(std::uint32_t width, std::uint32_t height, std::uint32_t depth, Layout&& layout)
+    {
+        clear();
+        canvas_ = std::size_t(width) * height * depth;
+        std::size_t rejected = 0;
+        std::uint32_t i = 0;
+        for (std::uint32_t z = 0; z < depth; ++z)
+            for (std::uint32_t y = 0; y < height; ++y)
+                for (std::uint32_t x = 0; x < width; ++x, ++i) {
+                    const Placement at = layout(x, y, z);
+                    if (at.channel == unplaced.channel)
+                        continue;
+                    if (at.channel >= channels_ || at.index >= length(at.channel) ||
+                        gather_[offsets_[at.channel] + at.index] != no_pixel) {
+                        ++rejected;
+                        continue;
+                    }
+                    gather_[offsets_[at.channel] + at.index] = i;
+                }
+        return rejected;
+    }
+
+    /// 2D convenience for compile().
+    template <typename Layout>
+    std::size_t compile(std::uint32_t width, std::uint32_t height, Layout&& layout)
+    {
+        return compile(width, height, 1,
+                       [&](std::uint32_t x, std::uint32_t y, std::uint32_t) { return layout(x, y); });
+    }
+
+    /// Marks every position unmapped (sent black).
+    void clear() noexcept
+    {
+        for (std::size_t i = 0; i < offsets_[channels_]; ++i)
+            gather_[i] = no_pixel;
+    }
+
+    std::size_t channels() const noexcept { return channels_; }
+    std::size_t length(std::size_t channel) const noexcept
+    {
+        return offsets_[channel + 1] - offsets_[channel];
+    }
+    /// Canvas pixels of the last compile().
+    std::size_t canvas_size() const noexcept { return canvas_; }
+
+    /// Canvas index of each wire position of `channel`, or no_pixel.
+    const std::uint32_t* gather(std::size_t channel) const noexcept
+    {
+        return gather_ + offsets_[channel];
+    }
+
+    /// Every channel's gather table back to back, table_size() entries;
+    /// what an ArtifactCache stores.
+    const std::uint32_t* tables() const noexcept { return gather_; }
+    std::size_t table_size() const noexcept { return offsets_[channels_]; }
+
+    /// Restores tables saved from tables() by an earlier compile() over a
+    /// canvas of `canvas` pixels, instead of compiling again.
+    void restore(const std::uint32_t* tables, std::size_t canvas) noexcept
+    {
+        std::memcpy(gather_, tables, table_size() * sizeof(std::uint32_t));
+        canvas_ = canvas;
+    }
+
+    /// Encodes output `channel` of `canvas` for `ChipT`.
+    template <typename ChipT, typename Format, typename Pixel>
+    typename Format::unit_type* encode(const Pixel* canvas, std::size_t channel,
+                                       typename Format::unit_type* out) const noexcept
+    {
+        return encode_chip_gather<ChipT, Format>(canvas, gather(channel), length(channel), out);
+    }
+
+private:
+    std::size_t set_offsets(const std::size_t* lengths) noexcept
+    {
+        offsets_[0] = 0;
+        for (std::size_t c = 0; c < channels_; ++c)
+            offsets_[c + 1] = offsets_[c] + lengths[c];
+        return offsets_[channels_];
+    }
+
+    std::unique_ptr<std::size_t[]> owned_offsets_;
+    std::unique_ptr<std::uint32_t[]> owned_gather_;
+    std::size_t* offsets_ = nullptr;
+    std::uint32_t* gather_ = nullptr;
+    std::size_t channels_;
+    std::size_t canvas_ = 0;
+};
+
+/// Layout of a serpentine matrix `width` pixels wide: rows alternate
+/// direction, starting left to right at y = 0, and each channel carries
+/// `rows_per_channel` consecutive rows. With `columns`, the strip snakes
+/// down columns instead and `width` is the column height.
+struct Serpentine {
+    std::uint32_t width;
+    std::uint32_t rows_per_channel = ~std::uint32_t(0);
+    bool columns = false;
+
+    Placement operator()(std::uint32_t x, std::uint32_t y) const noexcept
+    {
+        if (columns) {
+            const std::uint32_t t = x;
+            x = y;
+            y = t;
+        }
+        if (x >= width)
+            return unplaced;
+        const std::uint32_t row = y % rows_per_channel;
+        const std::uint32_t along = row % 2 ? width - 1 - x : x;
+        return Placement{y / rows_per_channel, row * width + along};
+    }
+};
+
+} // namespace ws2812b
@@ -0,0 +1,199 @@
+// Per-zone supply current limiting fused into the encode pass.
+//
+// Each LED's current is close to linear in its PWM duty, i.e. in the byte
+// it latches, plus a small quiescent draw. The encoder sums that estimate
+// per power-injection zone while it writes the zone's symbols; only a zone
+// that comes out over its budget is encoded a second time, with its values
+// scaled down to fit. The estimate is stored next to each value's symbols,
+// so frames within budget cost one add per byte over CorrectedEncoder and
+// no extra sweep.
+#pragma once
+
+#include "chip.hpp"
+#include "color_correction.hpp"
+#include "symbol_format.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace ws2812b {
+
+/// Current model per pixel, indexed by renderer channel (ch_r..ch_w).
+/// The defaults are typical for WS2812B at 5 V: about 12 mA per channel at
+/// full scale and 1 mA quiescent. Measure a strip to refine them.
+struct PowerModel {
+    std::uint32_t ua_per_lsb[4] = {47, 47, 47, 47};
+    std::uint32_t idle_ua = 1000;
+};
+
+/// A run of consecutive pixels fed by one injection point.
+struct PowerZone {
+    std::size_t pixels;
+    std::uint32_t budget_ma;
+};
+
+/// Corrected encode with per-zone current limiting. Zones follow each
+/// other from pixel 0; pixels past the last zone are not limited.
+template <typename ChipT, typename Format>
+class PowerLimitedEncoder {
+public:
+    using unit_type = typename Format::unit_type;
+    using entry_type = std::array<unit_type, Format::units_per_byte>;
+    static constexpr std::size_t channels = ChipT::channels;
+    /// zone_scale() of a zone that was not limited.
+    static constexpr std::uint32_t unscaled = 256;
+
+    PowerLimitedEncoder(const PowerZone* zones, std::size_t count, const PowerModel& model = PowerModel{},
+                        const ColorCorrection& c = ColorCorrection{})
+        : zones_(new Zone[count]), count_(count), model_(model), correction_(c)
+    {
+        for (std::size_t z = 0; z < count; ++z)
+            zones_[z].config = zones[z];
+    }
+
+    void set_correction(const ColorCorrection& c) noexcept
+    {
+        if (c != correction_) {
+            correction_ = c;
+            stale_ = true;
+        }
+    }
+
+    void set_model(const PowerModel& m) noexcept
+    {
+        model_ = m;
+        stale_ = true;
+    }
+
+    void set_budget(std::size_t zone, std::uint32_t budget_ma) noexcept
+    {
+        zones_[zone].config.budget_ma = budget_ma;
+    }
+
+    /// Rebuilds the tables now rather than in the next encode().
+    void rebuild()
+    {
+        for (std::size_t k = 0; k < channels; ++k) {
+            const std::uint8_t channel = ChipT::order::src[k];
+            const auto curve = correction_curve(correction_, channel);
+            for (unsigned v = 0; v < 256; ++v) {
+                const std::uint8_t corrected = std::uint8_t((curve[v] + 0x80) >> 8);
+                corrected_[k][v] = corrected;
+                tables_[k][v].ua = corrected * model_.ua_per_lsb[channel];
+                std::memcpy(tables_[k][v].units.data(), Format::table[corrected].data(), sizeof(entry_type));
+            }
+        }
+        stale_ = false;
+    }
+
+    /// Encodes `n` renderer pixels, limiting each zone to its budget.
+    template <typename Pixel>
+    unit_type* encode(const Pixel* px, std::size_t n, unit_type* out)
+    {
+        static_assert(symbols_fit<Format>(ChipT::timing), "format symbols violate the chip's timing");
+        if (stale_)
+            rebuild();
+        constexpr std::size_t stride = sizeof(Pixel);
+        const auto* p = reinterpret_cast<const std::uint8_t*>(px);
+        std::size_t first = 0;
+        for (std::size_t z = 0; z <= count_ && first < n; ++z) {
+            const std::size_t m = z < count_ ? std::min(zones_[z].config.pixels, n - first) : n - first;
+            const std::uint8_t* zp = p + first * stride;
+            unit_type* zout = out;
+            std::uint64_t led_ua = 0;
+            for (std::size_t i = 0; i < m; ++i)
+                out = encode_pixel<stride>(zp + i * stride, out, led_ua,
+                                           std::make_index_sequence<channels>{});
+            if (z < count_)
+                limit<stride>(zones_[z], m, led_ua, zp, zout);
+            first += m;
+        }
+        return out;
+    }
+
+    /// Estimated draw of zone `z` in the last frame, after limiting.
+    std::uint32_t zone_ma(std::size_t z) const noexcept { return zones_[z].ma; }
+    /// Scale applied to zone `z` in the last frame, out of 256.
+    std::uint32_t zone_scale(std::size_t z) const noexcept { return zones_[z].scale; }
+    /// Zone encodes that had to be scaled.
+    std::uint32_t limited() const noexcept { return limited_; }
+
+private:
+    struct Zone {
+        PowerZone config{};
+        std::uint32_t ma = 0;
+        std::uint32_t scale = unscaled;
+    };
+
+    /// Symbols and modelled current of one corrected value, fetched
+    /// together so the estimate costs no extra lookup.
+    struct Entry {
+        entry_type units;
+        std::uint32_t ua;
+    };
+
+    template <std::size_t Stride, std::size_t... K>
+    unit_type* encode_pixel(const std::uint8_t* p, unit_type* out, std::uint64_t& led_ua,
+                            std::index_sequence<K...>) const noexcept
+    {
+        constexpr std::size_t step = Format::units_per_byte;
+        std::uint32_t ua = 0;
+        ((ua += entry<Stride, K>(p).ua,
+          std::memcpy(out, entry<Stride, K>(p).units.data(), sizeof(entry_type)), out += step),
+         ...);
+        led_ua += ua;
+        return out;
+    }
+
+    template <std::size_t Stride, std::size_t K>
+    const Entry& entry(const std::uint8_t* p) const noexcept
+    {
+        constexpr std::uint8_t c = ChipT::order::src[K];
+        return tables_[K][c < Stride ? p[c] : 0];
+    }
+
+    /// Re-encodes the zone at `out` scaled into its budget if it is over.
+    template <std::size_t Stride>
+    void limit(Zone& zone, std::size_t m, std::uint64_t led_ua, const std::uint8_t* p,
+               unit_type* out) noexcept
+    {
+        const std::uint64_t idle_ua = std::uint64_t(model_.idle_ua) * m;
+        const std::uint64_t budget_ua = std::uint64_t(zone.config.budget_ma) * 1000;
+        zone.scale = unscaled;
+        // Quiescent draw alone can exceed the budget; with every LED dark
+        // there is nothing left to scale.
+        if (idle_ua + led_ua > budget_ua && led_ua != 0) {
+            const std::uint64_t room = budget_ua > idle_ua ? budget_ua - idle_ua : 0;
+            const std::uint32_t scale = std::uint32_t(room * 256 / led_ua);
+            zone.scale = scale;
+            led_ua = 0;
+            for (std::size_t i = 0; i < m; ++i, p += Stride) {
+                for (std::size_t k = 0; k < channels; ++k) {
+                    const std::uint8_t c = ChipT::order::src[k];
+                    const std::uint8_t v = std::uint8_t(corrected_[k][c < Stride ? p[c] : 0] * scale >> 8);
+                    led_ua += std::uint64_t(v) * model_.ua_per_lsb[c];
+                    std::memcpy(out, Format::table[v].data(), sizeof(entry_type));
+                    out += Format::units_per_byte;
+                }
+            }
+            ++limited_;
+        }
+        zone.ma = std::uint32_t((idle_ua + led_ua + 999) / 1000);
+    }
+
+    std::unique_ptr<Zone[]> zones_;
+    std::size_t count_;
+    PowerModel model_;
+    ColorCorrection correction_;
+    bool stale_ = true;
+    std::uint32_t limited_ = 0;
+    std::uint8_t corrected_[channels][256];
+    Entry tables_[channels][256];
+};
+
+} // namespace ws2812b
@@ -0,0 +1,66 @@
+// Calibration of the shortest reset gap a channel's parts reliably latch on.
+//
+// The datasheet only promises that RET >= 50us latches; actual thresholds
+// vary by batch (some need 280us, many latch far below 50us). On short
+// strips at high frame rates the gap is a large part of the frame, so each
+// channel is measured once and the result stored in its ChannelConfig.
+#pragma once
+
+#include "channel_config.hpp"
+
+#include <cstdint>
+
+namespace ws2812b {
+
+struct ResetCalibration {
+    std::uint32_t min_ns = 5'000;     ///< shortest gap tried
+    std::uint32_t max_ns = 300'000;   ///< longest gap tried; must latch
+    std::uint32_t resolution_ns = 1'000;
+    unsigned trials = 16;             ///< consecutive passes required per gap
+    unsigned margin_percent = 20;     ///< added to the shortest passing gap
+};
+
+/// Finds the shortest gap at which `probe(gap_ns)` passes `trials` times in
+/// a row, adds the margin and stores it as `channel.reset_ns`. Returns the
+/// stored gap, or 0 (leaving `channel` untouched) if even `max_ns` fails.
+///
+/// `probe` must send two different frames separated by exactly `gap_ns`
+/// of low line and return true if the chain latched both, e.g. by checking
+/// the loopback output or a sensor on the first pixel. A gap that is too
+/// short makes the second frame a continuation of the first, so the first
+/// pixels keep the first frame's colours. Latching is assumed monotonic in
+/// the gap, which allows a binary search.
+template <typename Probe>
+std::uint32_t calibrate_reset(ChannelConfig& channel, Probe&& probe,
+                              const ResetCalibration& cal = ResetCalibration{})
+{
+    const auto passes = [&](std::uint32_t gap) {
+        for (unsigned i = 0; i < cal.trials; ++i)
+            if (!probe(gap))
+                return false;
+        return true;
+    };
+
+    if (!passes(cal.max_ns))
+        return 0;
+    std::uint32_t lo = cal.min_ns; // may fail
+    std::uint32_t hi = cal.max_ns; // passes
+    if (passes(lo))
+        hi = lo;
+    while (hi - lo > cal.resolution_ns) {
+        const std::uint32_t mid = lo + (hi - lo) / 2;
+        if (passes(mid))
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    std::uint64_t gap = std::uint64_t(hi) * (100 + cal.margin_percent) / 100;
+    gap = (gap + cal.resolution_ns - 1) / cal.resolution_ns * cal.resolution_ns;
+    if (gap > cal.max_ns)
+        gap = cal.max_ns;
+    channel.reset_ns = std::uint32_t(gap);
+    return channel.reset_ns;
+}
+
+} // namespace ws2812b
@@ -0,0 +1,186 @@
+// Just-in-time encoding into a small circular DMA buffer.
+//
+// A fully encoded frame costs pixels * 24 * unit size: 1.1 MB for 48k
+// pixels of 8-bit-timer PWM words. Here DMA runs in circular mode over a
+// ring of two halves; when one half has been played (half-transfer or
+// transfer-complete interrupt) it is refilled straight from the pixel
+// array while the other half plays. Memory is the ring alone, whatever the
+// chain length. With an indexed frame (palette.hpp) the source is one byte
+// per pixel as well.
+#pragma once
+
+#include "arena.hpp"
+#include "chip.hpp"
+#include "chip_encoder.hpp"
+#include "lut_encoder.hpp"
+#include "palette.hpp"
+#include "pixel.hpp"
+#include "symbol_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// Refills a two-half circular buffer from renderer pixels of `ChipT`.
+///
+/// Each half holds whole pixels. The refill of a half must finish before
+/// the other half has been played, i.e. within refill_budget_ns(); a
+/// refill is one table lookup per byte for the half's pixels, so the
+/// budget sets the smallest workable half. Interrupts arriving out of
+/// order or while a refill is running are counted as underruns: the DMA
+/// has then replayed stale symbols.
+template <typename ChipT, typename Format, typename Pixel = Rgb>
+class StreamingEncoder {
+public:
+    using unit_type = typename Format::unit_type;
+    static constexpr std::size_t units_per_pixel = ChipT::channels * Format::units_per_byte;
+
+    /// `ring` holds 2 * pixels_per_half pixels of symbols.
+    StreamingEncoder(unit_type* ring, std::size_t pixels_per_half,
+                     std::uint32_t reset_ns = ChipT::timing.reset_ns) noexcept
+        : ring_(ring),
+          half_units_(pixels_per_half * units_per_pixel),
+          pixels_per_half_(pixels_per_half),
+          reset_units_(reset_units<Format>(reset_ns))
+    {
+    }
+
+    StreamingEncoder(Arena& arena, std::size_t pixels_per_half,
+                     std::uint32_t reset_ns = ChipT::timing.reset_ns, std::size_t align = 4)
+        : StreamingEncoder(arena.allocate<unit_type>(2 * pixels_per_half * units_per_pixel, align),
+                           pixels_per_half, reset_ns)
+    {
+    }
+
+    static constexpr ArenaLayout layout(std::size_t pixels_per_half, std::size_t align = 4) noexcept
+    {
+        return ArenaLayout{}.reserve<unit_type>(2 * pixels_per_half * units_per_pixel, align);
+    }
+
+    /// Smallest half that a refill taking `refill_ns_per_pixel` can keep
+    /// ahead of, with the refill allowed `headroom_percent` of the budget.
+    static constexpr std::size_t min_pixels_per_half(std::uint64_t refill_ns_per_pixel,
+                                                     std::uint64_t irq_latency_ns,
+                                                     unsigned headroom_percent = 50) noexcept
+    {
+        const std::uint64_t wire_ns_per_pixel = units_per_pixel * Format::unit_ps / 1000;
+        const std::uint64_t usable = wire_ns_per_pixel * headroom_percent / 100;
+        if (usable <= refill_ns_per_pixel)
+            return 0; // cannot keep up at any size
+        return std::size_t((irq_latency_ns * 100 / headroom_percent + usable - refill_ns_per_pixel - 1) /
+                           (usable - refill_ns_per_pixel)) + 1;
+    }
+
+    unit_type* ring() noexcept { return ring_; }
+    std::size_t ring_units() const noexcept { return 2 * half_units_; }
+
+    /// Time one half plays for: the deadline of every refill.
+    std::uint64_t refill_budget_ns() const noexcept
+    {
+        return half_units_ * Format::unit_ps / 1000;
+    }
+
+    /// Primes both halves with the start of a frame of `n` pixels. Start
+    /// circular DMA over ring() afterwards.
+    void begin(const Pixel* pixels, std::size_t n) noexcept
+    {
+        src_ = pixels;
+        palette_ = nullptr;
+        restart(n);
+    }
+
+    /// As begin(), for a frame of `n` indices into `palette`. Each refill
+    /// copies the palette entries of its pixels; neither the indices nor
+    /// the palette may change until done(), so swap palettes between
+    /// frames.
+    void begin(const std::uint8_t* indices, std::size_t n, const Palette<ChipT, Format>& palette) noexcept
+    {
+        indices_ = indices;
+        palette_ = &palette;
+        restart(n);
+    }
+
+    /// Half-transfer interrupt: the first half has been played. Returns true
+    /// once the frame and its RET are out; stop the DMA then.
+    bool on_half_transfer() noexcept { return played(0); }
+
+    /// Transfer-complete interrupt: the second half has been played.
+    bool on_transfer_complete() noexcept { return played(1); }
+
+    bool done() const noexcept { return done_; }
+    std::uint32_t underruns() const noexcept { return underruns_; }
+
+private:
+    void restart(std::size_t n) noexcept
+    {
+        count_ = n;
+        pos_ = 0;
+        idle_played_ = 0;
+        tail_half_ = 2;
+        tail_played_ = n == 0;
+        done_ = false;
+        next_half_ = 0;
+        fill(0);
+        fill(1);
+    }
+
+    bool played(unsigned half) noexcept
+    {
+        if (done_)
+            return true;
+        if (half != next_half_ || busy_)
+            ++underruns_;
+        busy_ = true;
+        next_half_ = half ^ 1u;
+        idle_played_ += idle_[half];
+        // Without RET padding the other half may still hold the last
+        // pixels when this one has been played; wait for that half.
+        if (half == tail_half_)
+            tail_played_ = true;
+        if (tail_played_ && idle_played_ >= reset_units_) {
+            done_ = true;
+        } else {
+            fill(half);
+        }
+        busy_ = false;
+        return done_;
+    }
+
+    /// Encodes the next pixels into `half`, padding with line-low units
+    /// once the frame is exhausted.
+    void fill(unsigned half) noexcept
+    {
+        unit_type* dst = ring_ + half * half_units_;
+        std::size_t k = count_ - pos_ < pixels_per_half_ ? count_ - pos_ : pixels_per_half_;
+        dst = palette_ ? encode_indexed<ChipT, Format>(indices_ + pos_, k, *palette_, dst)
+                       : encode_chip<ChipT, Format>(src_ + pos_, k, dst);
+        pos_ += k;
+        if (k != 0 && pos_ == count_)
+            tail_half_ = half;
+        const std::size_t idle = half_units_ - k * units_per_pixel;
+        encode_idle<Format>(idle, dst);
+        idle_[half] = idle;
+    }
+
+    unit_type* ring_;
+    std::size_t half_units_;
+    std::size_t pixels_per_half_;
+    std::size_t reset_units_;
+
+    const Pixel* src_ = nullptr;
+    const std::uint8_t* indices_ = nullptr;
+    const Palette<ChipT, Format>* palette_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t pos_ = 0;
+    std::size_t idle_[2] = {0, 0};
+    std::size_t idle_played_ = 0;
+    unsigned tail_half_ = 2; // half holding the last pixels; 2 before they are encoded
+    bool tail_played_ = false;
+    unsigned next_half_ = 0;
+    bool busy_ = false;
+    bool done_ = false;
+    std::uint32_t underruns_ = 0;
+};
+
+} // namespace ws2812b
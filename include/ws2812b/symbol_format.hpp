@@ -0,0 +1,308 @@
+// Symbol encodings of the 0-code/1-code waveform for common peripherals.
+//
+// A format turns every data byte into `units_per_byte` units of
+// `unit_type`, looked up from a table built at compile time. Units are what
+// the peripheral consumes: SPI bytes clocked out MSB first, or timer
+// compare values loaded by DMA once per bit period.
+#pragma once
+
+#include "chip.hpp"
+#include "timing.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ws2812b {
+
+namespace detail {
+
+/// Table of `N`-bit SPI symbols: each data bit becomes `zero` or `one`,
+/// high bit first, so a data byte packs MSB first into exactly N bytes.
+template <std::size_t N>
+constexpr std::array<std::array<std::uint8_t, N>, 256>
+make_spi_table(std::uint32_t zero, std::uint32_t one)
+{
+    std::array<std::array<std::uint8_t, N>, 256> table{};
+    for (unsigned v = 0; v < 256; ++v) {
+        std::uint32_t bits = 0;
+        for (int i = 7; i >= 0; --i)
+            bits = (bits << N) | (((v >> i) & 1u) ? one : zero);
+        for (std::size_t k = 0; k < N; ++k)
+            table[v][k] = std::uint8_t(bits >> (8 * (N - 1 - k)));
+    }
+    return table;
+}
+
+template <typename F, typename = void>
+struct is_spi_format : std::false_type {};
+template <typename F>
+struct is_spi_format<F, std::void_t<decltype(F::spi_clock_hz)>> : std::true_type {};
+
+template <typename F, typename = void>
+struct is_pwm_format : std::false_type {};
+template <typename F>
+struct is_pwm_format<F, std::void_t<decltype(F::timer_hz), decltype(F::period_ticks)>>
+    : std::true_type {};
+
+template <typename F, typename = void>
+struct is_parallel_format : std::false_type {};
+template <typename F>
+struct is_parallel_format<F, std::void_t<decltype(F::slot_hz)>> : std::true_type {};
+
+template <typename F, typename = void>
+struct is_rmt_format : std::false_type {};
+template <typename F>
+struct is_rmt_format<F, std::void_t<decltype(F::rmt_tick_hz)>> : std::true_type {};
+
+template <typename F, typename = void>
+struct is_raw_format : std::false_type {};
+template <typename F>
+struct is_raw_format<F, std::void_t<decltype(F::sm_clock_hz)>> : std::true_type {};
+
+/// Formats whose all-zero unit is not line-low declare `idle_unit`.
+template <typename F, typename = void>
+struct idle_of {
+    static constexpr typename F::unit_type value = 0;
+};
+template <typename F>
+struct idle_of<F, std::void_t<decltype(F::idle_unit)>> {
+    static constexpr typename F::unit_type value = F::idle_unit;
+};
+
+/// Formats that cannot express a low line (the peripheral times RET
+/// itself) declare `pads_reset = false`.
+template <typename F, typename = void>
+struct pads_reset : std::true_type {};
+template <typename F>
+struct pads_reset<F, std::void_t<decltype(F::pads_reset)>>
+    : std::integral_constant<bool, F::pads_reset> {};
+
+constexpr std::array<std::array<std::uint8_t, 1>, 256> make_identity_table()
+{
+    std::array<std::array<std::uint8_t, 1>, 256> table{};
+    for (unsigned v = 0; v < 256; ++v)
+        table[v][0] = std::uint8_t(v);
+    return table;
+}
+
+constexpr std::uint32_t ticks(std::uint32_t ns, std::uint32_t hz) noexcept
+{
+    return std::uint32_t((std::uint64_t(ns) * hz + 500'000'000u) / 1'000'000'000u);
+}
+
+} // namespace detail
+
+/// SPI symbols of `N` bits per data bit at `ClockHz`: a 0 is sent as
+/// `ZeroBits`, a 1 as `OneBits`, both a run of ones followed by zeros.
+template <std::size_t N, std::uint32_t ZeroBits, std::uint32_t OneBits, std::uint32_t ClockHz>
+struct SpiSymbols {
+    using unit_type = std::uint8_t;
+    static constexpr std::size_t units_per_byte = N;
+    static constexpr std::uint32_t spi_clock_hz = ClockHz;
+    static constexpr std::uint64_t unit_ps = 8'000'000'000'000ull / spi_clock_hz;
+    static constexpr auto table = detail::make_spi_table<N>(ZeroBits, OneBits);
+
+    static constexpr std::uint64_t bit_ps = 1'000'000'000'000ull * N / ClockHz;
+    static constexpr std::uint64_t high_ps(bool one) noexcept
+    {
+        std::uint32_t bits = one ? OneBits : ZeroBits;
+        std::uint64_t high = 0;
+        for (std::size_t i = 0; i < N; ++i, bits <<= 1)
+            high += (bits >> (N - 1)) & 1u;
+        return high * 1'000'000'000'000ull / ClockHz;
+    }
+};
+
+/// 3-bit SPI symbols at 2.4 MHz (416ns per symbol bit): 0 = 100, 1 = 110.
+using Spi3 = SpiSymbols<3, 0b100, 0b110, 2'400'000>;
+
+/// 4-bit SPI symbols at 3.2 MHz (312ns per symbol bit): 0 = 1000, 1 = 1110.
+using Spi4 = SpiSymbols<4, 0b1000, 0b1110, 3'200'000>;
+
+/// 4-bit SPI symbols at 3.2 MHz with a 625ns 1-code: 0 = 1000, 1 = 1100,
+/// for SK6812-timed parts.
+using Spi4Short = SpiSymbols<4, 0b1000, 0b1100, 3'200'000>;
+
+/// One timer compare value per data bit, for PWM channels reloaded by DMA
+/// at every update event. The timer is expected to run at `TimerHz` with an
+/// auto-reload of `period_ticks - 1`; a compare value of 0 holds the line
+/// low, which is what reset padding uses. Pulse widths follow `ChipT`.
+template <std::uint32_t TimerHz, typename Word = std::uint16_t, typename ChipT = Ws2812b>
+struct PwmWords {
+    using unit_type = Word;
+    static constexpr std::size_t units_per_byte = 8;
+    static constexpr std::uint32_t timer_hz = TimerHz;
+    static constexpr std::uint32_t period_ticks = detail::ticks(ChipT::timing.bit_ns(), TimerHz);
+    static constexpr Word t0h_ticks = Word(detail::ticks(ChipT::timing.t0h_ns, TimerHz));
+    static constexpr Word t1h_ticks = Word(detail::ticks(ChipT::timing.t1h_ns, TimerHz));
+    static constexpr std::uint64_t unit_ps =
+        std::uint64_t(period_ticks) * 1'000'000'000'000ull / TimerHz;
+
+    static_assert(t0h_ticks > 0 && t1h_ticks > t0h_ticks && period_ticks > t1h_ticks,
+                  "timer clock too slow to resolve T0H/T1H");
+
+    static constexpr std::array<std::array<Word, 8>, 256> make_table()
+    {
+        std::array<std::array<Word, 8>, 256> table{};
+        for (unsigned v = 0; v < 256; ++v)
+            for (unsigned i = 0; i < 8; ++i)
+                table[v][i] = ((v >> (7 - i)) & 1u) ? t1h_ticks : t0h_ticks;
+        return table;
+    }
+
+    static constexpr auto table = make_table();
+
+    static constexpr std::uint64_t bit_ps = unit_ps;
+    static constexpr std::uint64_t high_ps(bool one) noexcept
+    {
+        return std::uint64_t(one ? t1h_ticks : t0h_ticks) * 1'000'000'000'000ull / TimerHz;
+    }
+};
+
+/// One RMT item per data bit (ESP32): high for T0H/T1H, then low for
+/// T0L/T1L, in ticks of `TickHz` (80 MHz APB / clk_div 2 by default).
+/// Item layout is rmt_item32_t: duration0 bits 0..14, level0 bit 15,
+/// duration1 bits 16..30, level1 bit 31. A zero item ends an RMT
+/// transmission, so RET padding uses low items of one bit period each.
+template <typename ChipT = Ws2812b, std::uint32_t TickHz = 40'000'000>
+struct RmtItems {
+    using unit_type = std::uint32_t;
+    static constexpr std::size_t units_per_byte = 8;
+    static constexpr std::uint32_t rmt_tick_hz = TickHz;
+
+    static constexpr std::uint32_t item(std::uint32_t high, std::uint32_t low,
+                                        bool level0 = true) noexcept
+    {
+        return high | (std::uint32_t(level0) << 15) | (low << 16);
+    }
+
+    static constexpr std::uint32_t t0h = detail::ticks(ChipT::timing.t0h_ns, TickHz);
+    static constexpr std::uint32_t t0l = detail::ticks(ChipT::timing.t0l_ns, TickHz);
+    static constexpr std::uint32_t t1h = detail::ticks(ChipT::timing.t1h_ns, TickHz);
+    static constexpr std::uint32_t t1l = detail::ticks(ChipT::timing.t1l_ns, TickHz);
+    static constexpr std::uint32_t period = detail::ticks(ChipT::timing.bit_ns(), TickHz);
+    static constexpr std::uint64_t unit_ps = std::uint64_t(period) * 1'000'000'000'000ull / TickHz;
+    static constexpr unit_type idle_unit = item(period / 2, period - period / 2, false);
+
+    static_assert(t1h < 0x8000 && t0l < 0x8000 && period < 0x8000, "RMT durations are 15 bits");
+
+    static constexpr std::array<std::array<std::uint32_t, 8>, 256> make_table()
+    {
+        std::array<std::array<std::uint32_t, 8>, 256> table{};
+        for (unsigned v = 0; v < 256; ++v)
+            for (unsigned i = 0; i < 8; ++i)
+                table[v][i] = ((v >> (7 - i)) & 1u) ? item(t1h, t1l) : item(t0h, t0l);
+        return table;
+    }
+
+    static constexpr auto table = make_table();
+
+    static constexpr std::uint64_t bit_ps = unit_ps;
+    static constexpr std::uint64_t high_ps(bool one) noexcept
+    {
+        return std::uint64_t(one ? t1h : t0h) * 1'000'000'000'000ull / TickHz;
+    }
+};
+
+/// Plain wire-order bytes for a PIO state machine (RP2040) that generates
+/// the waveform itself: 10 cycles per bit at `sm_clock_hz`; a 0 is 3 high /
+/// 7 low, a 1 is 6 high / 4 low. RET is a pause the backend times, so no
+/// padding is appended.
+struct PioBytes {
+    using unit_type = std::uint8_t;
+    static constexpr std::size_t units_per_byte = 1;
+    static constexpr std::uint32_t sm_clock_hz = 8'000'000;
+    static constexpr std::uint32_t cycles_per_bit = 10;
+    static constexpr std::uint32_t zero_high_cycles = 3;
+    static constexpr std::uint32_t one_high_cycles = 6;
+    static constexpr bool pads_reset = false;
+    static constexpr std::uint64_t bit_ps =
+        std::uint64_t(cycles_per_bit) * 1'000'000'000'000ull / sm_clock_hz;
+    static constexpr std::uint64_t unit_ps = 8 * bit_ps;
+
+    static constexpr auto table = detail::make_identity_table();
+
+    static constexpr std::uint64_t high_ps(bool one) noexcept
+    {
+        return std::uint64_t(one ? one_high_cycles : zero_high_cycles) * 1'000'000'000'000ull /
+               sm_clock_hz;
+    }
+};
+
+/// Identifies a symbol format in persisted data.
+struct FormatId {
+    std::uint32_t kind;           ///< see FormatKind
+    std::uint32_t units_per_byte;
+    std::uint32_t unit_bytes;
+    std::uint32_t clock_hz;       ///< SPI, timer or port slot clock; 0 for wire bytes
+
+    friend constexpr bool operator==(const FormatId& a, const FormatId& b) noexcept
+    {
+        return a.kind == b.kind && a.units_per_byte == b.units_per_byte &&
+               a.unit_bytes == b.unit_bytes && a.clock_hz == b.clock_hz;
+    }
+    friend constexpr bool operator!=(const FormatId& a, const FormatId& b) noexcept
+    {
+        return !(a == b);
+    }
+};
+
+enum FormatKind : std::uint32_t {
+    format_wire_bytes = 0, ///< unencoded pixel bytes in wire order
+    format_spi = 1,
+    format_pwm = 2,
+    format_parallel = 3,
+    format_rmt = 4,
+    format_raw = 5,
+};
+
+/// Plain wire-order pixel bytes.
+inline constexpr FormatId wire_bytes_id{format_wire_bytes, 1, 1, 0};
+
+template <typename Format>
+constexpr FormatId format_id() noexcept
+{
+    constexpr std::uint32_t upb = std::uint32_t(Format::units_per_byte);
+    constexpr std::uint32_t ub = sizeof(typename Format::unit_type);
+    if constexpr (detail::is_spi_format<Format>::value)
+        return FormatId{format_spi, upb, ub, Format::spi_clock_hz};
+    else if constexpr (detail::is_pwm_format<Format>::value)
+        return FormatId{format_pwm, upb, ub, Format::timer_hz};
+    else if constexpr (detail::is_rmt_format<Format>::value)
+        return FormatId{format_rmt, upb, ub, Format::rmt_tick_hz};
+    else if constexpr (detail::is_raw_format<Format>::value)
+        return FormatId{format_raw, upb, ub, Format::sm_clock_hz};
+    else
+        return FormatId{format_parallel, upb, ub, Format::slot_hz};
+}
+
+/// True if the 0-code and 1-code of `Format` fall inside every window of
+/// `t`; use in a static_assert to pair formats with chips.
+template <typename Format>
+constexpr bool symbols_fit(const Timing& t) noexcept
+{
+    const auto within = [&](std::uint64_t ps, std::uint32_t nominal_ns) {
+        const std::uint64_t lo = std::uint64_t(nominal_ns - t.tolerance_ns) * 1000;
+        const std::uint64_t hi = std::uint64_t(nominal_ns + t.tolerance_ns) * 1000;
+        return ps >= lo && ps <= hi;
+    };
+    const std::uint64_t h0 = Format::high_ps(false);
+    const std::uint64_t h1 = Format::high_ps(true);
+    return within(h0, t.t0h_ns) && within(Format::bit_ps - h0, t.t0l_ns) &&
+           within(h1, t.t1h_ns) && within(Format::bit_ps - h1, t.t1l_ns);
+}
+
+/// Number of idle (line-low) units needed to hold the line low for `ns`;
+/// 0 for formats whose peripheral times RET itself.
+template <typename Format>
+constexpr std::size_t reset_units(std::uint32_t ns = ws2812b_timing.reset_ns) noexcept
+{
+    if constexpr (!detail::pads_reset<Format>::value)
+        return 0;
+    else
+        return std::size_t((std::uint64_t(ns) * 1000u + Format::unit_ps - 1) / Format::unit_ps);
+}
+
+} // namespace ws2812b
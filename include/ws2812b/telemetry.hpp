@@ -0,0 +1,172 @@
+// Always-on transmit metrics in per-thread counter blocks.
+//
+// Each thread that records gets its own cache-line-aligned block, so the
+// hot path is a relaxed load and store on a line no other thread writes:
+// no atomic read-modify-write, no false sharing. snapshot() sums the
+// blocks from any thread. Threads beyond max_threads share one overflow
+// block updated with fetch_add.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+enum class Counter : unsigned {
+    frames,          ///< frames encoded
+    encode_ns,       ///< total encode time
+    encode_max_ns,   ///< slowest single encode
+    underruns,       ///< DMA refills that missed their deadline
+    reset_overruns,  ///< frames started after their governor slot
+    dropped,         ///< frames replaced before transmission
+    late,            ///< frames transmitted after their deadline
+    queue_depth_max, ///< most frames queued on an engine at once
+    count
+};
+
+inline constexpr std::size_t counter_count = std::size_t(Counter::count);
+
+inline constexpr const char* counter_name(Counter c) noexcept
+{
+    constexpr const char* names[counter_count] = {
+        "frames", "encode_ns", "encode_max_ns", "underruns",
+        "reset_overruns", "dropped", "late", "queue_depth_max",
+    };
+    return names[std::size_t(c)];
+}
+
+/// Counters with max semantics; all others are sums.
+inline constexpr bool counter_is_max(Counter c) noexcept
+{
+    return c == Counter::encode_max_ns || c == Counter::queue_depth_max;
+}
+
+struct TelemetrySnapshot {
+    std::uint64_t values[counter_count] = {};
+
+    std::uint64_t operator[](Counter c) const noexcept { return values[std::size_t(c)]; }
+
+    /// Mean encode time per frame.
+    std::uint64_t encode_mean_ns() const noexcept
+    {
+        const std::uint64_t n = (*this)[Counter::frames];
+        return n ? (*this)[Counter::encode_ns] / n : 0;
+    }
+};
+
+class Telemetry {
+public:
+    static constexpr unsigned max_threads = 16;
+
+    /// One thread's counters. Only its owning thread may call add()/max().
+    class alignas(64) Local {
+    public:
+        void add(Counter c, std::uint64_t v = 1) noexcept
+        {
+            auto& slot = values_[std::size_t(c)];
+            if (shared_)
+                slot.fetch_add(v, std::memory_order_relaxed);
+            else
+                slot.store(slot.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+
+        void max(Counter c, std::uint64_t v) noexcept
+        {
+            auto& slot = values_[std::size_t(c)];
+            std::uint64_t cur = slot.load(std::memory_order_relaxed);
+            if (!shared_) {
+                if (v > cur)
+                    slot.store(v, std::memory_order_relaxed);
+                return;
+            }
+            while (v > cur && !slot.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+            }
+        }
+
+        /// One encoded frame that took `ns`.
+        void frame_encoded(std::uint64_t ns) noexcept
+        {
+            add(Counter::frames);
+            add(Counter::encode_ns, ns);
+            max(Counter::encode_max_ns, ns);
+        }
+
+    private:
+        friend class Telemetry;
+        std::atomic<std::uint64_t> values_[counter_count] = {};
+        bool shared_ = false;
+    };
+
+    Telemetry() noexcept { overflow_.shared_ = true; }
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    /// The calling thread's block, registered on first use. A thread keeps
+    /// one cached registration, so it should record into one Telemetry
+    /// (normally one per process); switching re-registers.
+    Local& local() noexcept
+    {
+        struct Cache {
+            const Telemetry* owner = nullptr;
+            std::uint64_t epoch = 0;
+            Local* block = nullptr;
+        };
+        thread_local Cache cache;
+        if (cache.owner != this || cache.epoch != epoch_) {
+            const unsigned i = registered_.fetch_add(1, std::memory_order_relaxed);
+            cache = Cache{this, epoch_, i < max_threads ? &blocks_[i] : &overflow_};
+        }
+        return *cache.block;
+    }
+
+    /// Sums (or maxes) every thread's counters. Concurrent updates may or
+    /// may not be included; each value is individually consistent.
+    TelemetrySnapshot snapshot() const noexcept
+    {
+        TelemetrySnapshot s;
+        unsigned n = registered_.load(std::memory_order_relaxed);
+        if (n > max_threads)
+            n = max_threads;
+        for (std::size_t c = 0; c < counter_count; ++c) {
+            std::uint64_t v = overflow_.values_[c].load(std::memory_order_relaxed);
+            for (unsigned i = 0; i < n; ++i) {
+                const std::uint64_t b = blocks_[i].values_[c].load(std::memory_order_relaxed);
+                v = counter_is_max(Counter(c)) ? (b > v ? b : v) : v + b;
+            }
+            s.values[c] = v;
+        }
+        return s;
+    }
+
+private:
+    // Distinguishes a Telemetry from an earlier one at the same address.
+    static std::uint64_t next_epoch() noexcept
+    {
+        static std::atomic<std::uint64_t> epochs{0};
+        return epochs.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    const std::uint64_t epoch_ = next_epoch();
+    std::atomic<unsigned> registered_{0};
+    Local blocks_[max_threads];
+    Local overflow_;
+};
+
+/// Copies a component's own counters (FrameQueue dropped()/late(),
+/// StreamingEncoder underruns(), FrameGovernor deadline_misses()) into
+/// `local` as the increase since the previous call. A total that went
+/// down (the component's counters were reset) counts from zero.
+class CounterDelta {
+public:
+    void update(Telemetry::Local& local, Counter c, std::uint64_t total) noexcept
+    {
+        local.add(c, total >= last_ ? total - last_ : total);
+        last_ = total;
+    }
+
+private:
+    std::uint64_t last_ = 0;
+};
+
+} // namespace ws2812b
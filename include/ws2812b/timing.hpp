@@ -0,0 +1,50 @@
+// WS2812B line timing as specified in the datasheet.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// Pulse widths of the single-wire protocol, in nanoseconds.
+///
+/// A 0-code is T0H high followed by T0L low, a 1-code is T1H high followed
+/// by T1L low. Every high/low width may deviate by `tolerance_ns`. Data is
+/// latched once the line has been held low for at least `reset_ns` (RET).
+struct Timing {
+    std::uint32_t t0h_ns;
+    std::uint32_t t0l_ns;
+    std::uint32_t t1h_ns;
+    std::uint32_t t1l_ns;
+    std::uint32_t tolerance_ns;
+    std::uint32_t reset_ns;
+
+    constexpr std::uint32_t bit0_ns() const noexcept { return t0h_ns + t0l_ns; }
+    constexpr std::uint32_t bit1_ns() const noexcept { return t1h_ns + t1l_ns; }
+
+    /// Longest of the two bit periods; the worst case for frame pacing.
+    constexpr std::uint32_t bit_ns() const noexcept
+    {
+        return bit0_ns() > bit1_ns() ? bit0_ns() : bit1_ns();
+    }
+};
+
+/// Datasheet values: T0H 0.4us, T0L 0.85us, T1H 0.8us, T1L 0.45us,
+/// +-150ns on every width, RET >= 50us.
+inline constexpr Timing ws2812b_timing{400, 850, 800, 450, 150, 50'000};
+
+/// SK6812 and its RGBW variants: T0H 0.3us, T0L 0.9us, T1H 0.6us,
+/// T1L 0.6us, +-150ns, RET >= 80us.
+inline constexpr Timing sk6812_timing{300, 900, 600, 600, 150, 80'000};
+
+/// Bits sent per WS2812B pixel: G7..G0, R7..R0, B7..B0.
+inline constexpr std::size_t bits_per_pixel = 24;
+
+/// Worst-case time on the wire for `pixels` cascaded pixels including RET.
+constexpr std::uint64_t frame_wire_ns(std::size_t pixels, const Timing& t = ws2812b_timing,
+                                      std::size_t pixel_bits = bits_per_pixel) noexcept
+{
+    return std::uint64_t(pixels) * pixel_bits * t.bit_ns() + t.reset_ns;
+}
+
+} // namespace ws2812b
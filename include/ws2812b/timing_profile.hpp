@@ -0,0 +1,132 @@
+// Timing profiles that trade datasheet margin for a shorter bit period.
+//
+// Every pixel regenerates the waveform it passes on, so only the first
+// pixel of a cascade sees the controller's edges, and it accepts anything
+// inside the datasheet windows. A profile aims every width at the short
+// end of its window, keeping `margin_ns` for jitter and edge skew; the bit
+// period shrinks by about 2 * (tolerance - margin).
+//
+// Backends that set each width in fine ticks (PwmWords, RmtItems) take the
+// profile as a Chip. SPI can only place edges on its clock grid, so
+// solve_spi() searches the clock divisors the controller offers for the
+// symbol that is shortest while staying `margin_ns` inside every window.
+#pragma once
+
+#include "chip.hpp"
+#include "symbol_format.hpp"
+#include "timing.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ws2812b {
+
+/// `t` with every width moved to `margin_ns` above the bottom of its
+/// window, and `margin_ns` as the tolerance left around the new targets.
+/// RET is unchanged. A margin beyond the tolerance is clamped to it.
+constexpr Timing edge_profile(const Timing& t, std::uint32_t margin_ns) noexcept
+{
+    const std::uint32_t m = margin_ns < t.tolerance_ns ? margin_ns : t.tolerance_ns;
+    const std::uint32_t cut = t.tolerance_ns - m;
+    return Timing{t.t0h_ns - cut, t.t0l_ns - cut, t.t1h_ns - cut, t.t1l_ns - cut, m, t.reset_ns};
+}
+
+/// WS2812B with 50ns of margin: T0H 300, T0L 750, T1H 700, T1L 350,
+/// a 1.05us bit (16% shorter than nominal).
+inline constexpr Timing ws2812b_fast_timing = edge_profile(ws2812b_timing, 50);
+
+using Ws2812bFast = Chip<OrderGrb, ws2812b_fast_timing>;
+
+/// Result of solve_spi(): a clock and the two symbols, or clock_hz 0.
+struct SpiSolution {
+    std::uint32_t clock_hz = 0;
+    std::uint32_t divisor = 0;
+    std::uint32_t zero_bits = 0;
+    std::uint32_t one_bits = 0;
+
+    constexpr explicit operator bool() const noexcept { return clock_hz != 0; }
+    /// Bit period, in ps, for `n`-bit symbols.
+    constexpr std::uint64_t bit_ps(std::size_t n) const noexcept
+    {
+        return 1'000'000'000'000ull * n / clock_hz;
+    }
+};
+
+/// Shortest `n`-bit SPI symbols for datasheet timing `t` on a controller
+/// clocked at `base_hz / d` for d = div_step, 2 * div_step, ...: every
+/// width must lie `margin_ns` inside its window. Symbols are a run of ones
+/// followed by zeros with at least one of each.
+constexpr SpiSolution solve_spi(const Timing& t, std::size_t n, std::uint32_t base_hz,
+                                std::uint32_t div_step = 1, std::uint32_t margin_ns = 25) noexcept
+{
+    const auto within = [&](std::uint64_t ps, std::uint32_t nominal_ns) {
+        const std::uint64_t lo = (std::uint64_t(nominal_ns) + margin_ns - t.tolerance_ns) * 1000;
+        const std::uint64_t hi = (std::uint64_t(nominal_ns) + t.tolerance_ns - margin_ns) * 1000;
+        return ps >= lo && ps <= hi;
+    };
+    if (margin_ns >= t.tolerance_ns || n < 2 || n > 4 || div_step == 0)
+        return SpiSolution{};
+    // The bit period grows with the divisor, so the first fit is the shortest.
+    for (std::uint32_t d = div_step; base_hz / d * n >= 1'000'000; d += div_step) {
+        const std::uint32_t hz = base_hz / d;
+        const std::uint64_t bit = 1'000'000'000'000ull * n / hz;
+        for (std::size_t k0 = 1; k0 + 1 < n; ++k0) {
+            const std::uint64_t h0 = 1'000'000'000'000ull * k0 / hz;
+            if (!within(h0, t.t0h_ns) || !within(bit - h0, t.t0l_ns))
+                continue;
+            for (std::size_t k1 = k0 + 1; k1 < n; ++k1) {
+                const std::uint64_t h1 = 1'000'000'000'000ull * k1 / hz;
+                if (within(h1, t.t1h_ns) && within(bit - h1, t.t1l_ns)) {
+                    const auto run = [n](std::size_t k) { return ((1u << k) - 1) << (n - k); };
+                    return SpiSolution{hz, d, run(k0), run(k1)};
+                }
+            }
+        }
+    }
+    return SpiSolution{};
+}
+
+namespace detail {
+
+template <const Timing& T, std::size_t N, std::uint32_t BaseHz, std::uint32_t DivStep, std::uint32_t MarginNs>
+struct spi_solution {
+    static constexpr SpiSolution value = solve_spi(T, N, BaseHz, DivStep, MarginNs);
+    static_assert(bool(value), "no SPI clock on this divisor grid fits the timing windows");
+};
+
+} // namespace detail
+
+/// The SpiSymbols format solve_spi() picks, e.g.
+/// SolvedSpi<ws2812b_timing, 3, 250'000'000, 2> for a Raspberry Pi, whose
+/// SPI clock is the 250MHz core clock over an even divisor: 2.717MHz, a
+/// 1.104us bit against Spi3's 1.25us.
+template <const Timing& T, std::size_t N, std::uint32_t BaseHz, std::uint32_t DivStep = 1,
+          std::uint32_t MarginNs = 25>
+using SolvedSpi = SpiSymbols<N, detail::spi_solution<T, N, BaseHz, DivStep, MarginNs>::value.zero_bits,
+                             detail::spi_solution<T, N, BaseHz, DivStep, MarginNs>::value.one_bits,
+                             detail::spi_solution<T, N, BaseHz, DivStep, MarginNs>::value.clock_hz>;
+
+/// The widths `Format` actually puts on the wire, rounded to ns, with the
+/// tolerance that is left of `datasheet`'s windows and its RET. Pace a
+/// channel with this rather than the datasheet when the format runs fast.
+template <typename Format>
+constexpr Timing wire_timing(const Timing& datasheet) noexcept
+{
+    const auto ns = [](std::uint64_t ps) { return std::uint32_t((ps + 500) / 1000); };
+    const std::uint32_t h0 = ns(Format::high_ps(false));
+    const std::uint32_t h1 = ns(Format::high_ps(true));
+    const std::uint32_t bit = ns(Format::bit_ps);
+    // What is left of the tolerance once the width is off its nominal.
+    const auto left = [&](std::uint32_t width, std::uint32_t nominal) {
+        const std::uint32_t off = width > nominal ? width - nominal : nominal - width;
+        return datasheet.tolerance_ns > off ? datasheet.tolerance_ns - off : 0u;
+    };
+    Timing w{h0, bit - h0, h1, bit - h1, 0, datasheet.reset_ns};
+    const std::uint32_t l0 = std::min(left(w.t0h_ns, datasheet.t0h_ns), left(w.t0l_ns, datasheet.t0l_ns));
+    const std::uint32_t l1 = std::min(left(w.t1h_ns, datasheet.t1h_ns), left(w.t1l_ns, datasheet.t1l_ns));
+    w.tolerance_ns = std::min(l0, l1);
+    return w;
+}
+
+} // namespace ws2812b
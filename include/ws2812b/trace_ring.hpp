@@ -0,0 +1,167 @@
+// Fixed-size event ring exported as Chrome trace JSON (Perfetto, chrome://tracing).
+//
+// Any thread or ISR can record: an event claims its slot with one
+// fetch_add and publishes it under a per-slot sequence number, so
+// recording never blocks and the ring keeps the newest `capacity` events.
+// Export reads the slots the same way and skips any being overwritten.
+// Timestamps are the caller's, in ns; names must be string literals or
+// otherwise outlive the ring.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+namespace ws2812b {
+
+class TraceRing {
+public:
+    /// `capacity` is rounded up to a power of two.
+    explicit TraceRing(std::size_t capacity = 4096)
+        : mask_(round_up(capacity) - 1), slots_(new Slot[mask_ + 1])
+    {
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    /// A span of `dur_ns` starting at `ts_ns` on track `tid`.
+    void complete(const char* name, std::uint64_t ts_ns, std::uint64_t dur_ns,
+                  std::uint32_t tid = current_tid()) noexcept
+    {
+        record(name, 'X', ts_ns, dur_ns, tid);
+    }
+
+    /// A point event, e.g. a DMA underrun.
+    void instant(const char* name, std::uint64_t ts_ns, std::uint32_t tid = current_tid()) noexcept
+    {
+        record(name, 'i', ts_ns, 0, tid);
+    }
+
+    /// A sample of counter track `name`, e.g. queue depth.
+    void counter(const char* name, std::uint64_t ts_ns, std::uint64_t value) noexcept
+    {
+        record(name, 'C', ts_ns, value, 0);
+    }
+
+    /// Small per-thread track id, assigned on first use.
+    static std::uint32_t current_tid() noexcept
+    {
+        static std::atomic<std::uint32_t> next{1};
+        thread_local const std::uint32_t tid = next.fetch_add(1, std::memory_order_relaxed);
+        return tid;
+    }
+
+    /// Events recorded since construction, including overwritten ones.
+    std::uint64_t recorded() const noexcept { return head_.load(std::memory_order_relaxed); }
+
+    /// Writes the retained events, oldest first, as a Chrome trace JSON
+    /// object. Returns the number written.
+    std::size_t write_chrome_trace(std::FILE* out) const
+    {
+        const std::uint64_t head = head_.load(std::memory_order_acquire);
+        const std::uint64_t first = head > capacity() ? head - capacity() : 0;
+        std::fputs("{\"traceEvents\":[\n", out);
+        std::size_t written = 0;
+        for (std::uint64_t i = first; i < head; ++i) {
+            const Slot& s = slots_[i & mask_];
+            const std::uint64_t seq = s.seq.load(std::memory_order_acquire);
+            const auto* name = reinterpret_cast<const char*>(s.name.load(std::memory_order_acquire));
+            const std::uint64_t packed = s.packed.load(std::memory_order_acquire);
+            const std::uint64_t ts = s.ts.load(std::memory_order_acquire);
+            const std::uint64_t arg = s.arg.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2 || s.seq.load(std::memory_order_relaxed) != seq)
+                continue; // not yet published, or overwritten meanwhile
+            const char phase = char(packed >> 32);
+            const auto tid = std::uint32_t(packed);
+            std::fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+                         written ? ",\n" : "", name, phase, double(ts) / 1000.0, unsigned(tid));
+            if (phase == 'X')
+                std::fprintf(out, ",\"dur\":%.3f}", double(arg) / 1000.0);
+            else if (phase == 'C')
+                std::fprintf(out, ",\"args\":{\"value\":%llu}}", static_cast<unsigned long long>(arg));
+            else
+                std::fputs(",\"s\":\"t\"}", out);
+            ++written;
+        }
+        std::fputs("\n]}\n", out);
+        return written;
+    }
+
+private:
+    // Fields are atomics so export can read a slot that is being
+    // rewritten without a data race; `seq` tells whether it was consistent.
+    struct Slot {
+        std::atomic<std::uint64_t> seq{0}; ///< 2i+1 while event i is written, 2i+2 once done
+        std::atomic<std::uintptr_t> name{0};
+        std::atomic<std::uint64_t> packed{0}; ///< phase << 32 | tid
+        std::atomic<std::uint64_t> ts{0};
+        std::atomic<std::uint64_t> arg{0};
+    };
+
+    static std::size_t round_up(std::size_t n) noexcept
+    {
+        std::size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    void record(const char* name, char phase, std::uint64_t ts, std::uint64_t arg,
+                std::uint32_t tid) noexcept
+    {
+        const std::uint64_t i = head_.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = slots_[i & mask_];
+        // Release stores: a reader that sees any new field also sees the odd
+        // sequence number before it, and rejects the slot.
+        s.seq.store(2 * i + 1, std::memory_order_relaxed);
+        s.name.store(reinterpret_cast<std::uintptr_t>(name), std::memory_order_release);
+        s.packed.store(std::uint64_t(std::uint8_t(phase)) << 32 | tid, std::memory_order_release);
+        s.ts.store(ts, std::memory_order_release);
+        s.arg.store(arg, std::memory_order_release);
+        s.seq.store(2 * i + 2, std::memory_order_release);
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<std::uint64_t> head_{0};
+};
+
+/// Records the enclosing scope as a span of `name` on `ring`; a null ring
+/// leaves only the clock reads, so spans can stay in release builds.
+/// `Clock` is any clock with the std::chrono interface.
+template <typename Clock = std::chrono::steady_clock>
+class TraceSpan {
+public:
+    explicit TraceSpan(TraceRing* ring, const char* name) noexcept
+        : ring_(ring), name_(name), start_(now())
+    {
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan()
+    {
+        if (ring_)
+            ring_->complete(name_, start_, now() - start_);
+    }
+
+    std::uint64_t elapsed_ns() const noexcept { return now() - start_; }
+
+    static std::uint64_t now() noexcept
+    {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 Clock::now().time_since_epoch())
+                                 .count());
+    }
+
+private:
+    TraceRing* ring_;
+    const char* name_;
+    std::uint64_t start_;
+};
+
+} // namespace ws2812b
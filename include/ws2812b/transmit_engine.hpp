@@ -0,0 +1,267 @@
+// Multi-buffered transmit engine: the application encodes into one buffer
+// while the peripheral streams another.
+#pragma once
+
+#include "arena.hpp"
+#include "backend.hpp"
+#include "lut_encoder.hpp"
+#include "symbol_format.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ws2812b {
+
+/// A buffer lent to the application for encoding one frame.
+template <typename Unit>
+struct FrameBuffer {
+    Unit* data = nullptr;
+    std::size_t capacity = 0; ///< data units available, reset padding excluded
+    std::uint8_t index = 0;
+
+    explicit operator bool() const noexcept { return data != nullptr; }
+};
+
+/// Owns `Buffers` encoded frame buffers and hands them between the
+/// application and a DMA backend without copying.
+///
+/// `Backend` must provide `void start(const unit_type* data, std::size_t
+/// units)`, which begins a non-blocking transfer, and must call
+/// `on_transfer_complete()` once the last unit has been shifted out; see
+/// backend.hpp. Backends with `set_completion()` are wired up by the
+/// constructor. Every buffer ends with idle units covering RET, so the
+/// completion callback is the latch boundary and the next buffer is
+/// started from it immediately.
+///
+/// `acquire()`/`submit()` may be called from one application thread while
+/// `on_transfer_complete()` runs in interrupt context; neither side blocks.
+template <typename Format, typename Backend, std::size_t Buffers = 2>
+class TransmitEngine {
+    static_assert(Buffers >= 2, "at least two buffers are needed to overlap render and wire time");
+    static_assert(Buffers <= 255, "buffer index must fit in FrameBuffer::index");
+
+public:
+    using format_type = Format;
+    using unit_type = typename Format::unit_type;
+    using frame_type = FrameBuffer<unit_type>;
+
+    /// Buffer alignment used unless the arena constructor is told otherwise.
+    static constexpr std::size_t default_alignment = buffer_alignment<Backend, unit_type>();
+
+    /// Allocates every buffer for `pixels` pixels plus RET of `reset_ns`
+    /// from the heap, in one block.
+    TransmitEngine(Backend& backend, std::size_t pixels,
+                   std::uint32_t reset_ns = ws2812b_timing.reset_ns)
+        : TransmitEngine(backend,
+                         std::make_unique<Arena>(layout(pixels, reset_ns, default_alignment).bytes()),
+                         pixels, reset_ns)
+    {
+    }
+
+    /// Takes every buffer from `arena`, each aligned to `align` bytes.
+    TransmitEngine(Backend& backend, Arena& arena, std::size_t pixels,
+                   std::uint32_t reset_ns = ws2812b_timing.reset_ns,
+                   std::size_t align = default_alignment)
+        : backend_(backend),
+          capacity_(encoded_units<Format>(pixels)),
+          max_reset_units_(reset_units<Format>(reset_ns)),
+          reset_units_(max_reset_units_)
+    {
+        for (auto& slot : slots_)
+            slot.wire = slot.data = arena.allocate<unit_type>(stride(), align);
+        if constexpr (detail::has_completion_hook<Backend>::value)
+            backend_.set_completion(&TransmitEngine::transfer_complete, this);
+    }
+
+    /// Arena space taken by the arena constructor.
+    static constexpr ArenaLayout layout(std::size_t pixels,
+                                        std::uint32_t reset_ns = ws2812b_timing.reset_ns,
+                                        std::size_t align = default_alignment) noexcept
+    {
+        ArenaLayout l;
+        for (std::size_t i = 0; i < Buffers; ++i)
+            l.reserve<unit_type>(encoded_units<Format>(pixels) + reset_units<Format>(reset_ns),
+                                 align);
+        return l;
+    }
+
+    TransmitEngine(const TransmitEngine&) = delete;
+    TransmitEngine& operator=(const TransmitEngine&) = delete;
+
+    /// Lends a free buffer to the caller, or returns an empty frame if every
+    /// buffer is queued or on the wire.
+    frame_type acquire() noexcept
+    {
+        for (std::size_t i = 0; i < Buffers; ++i) {
+            std::uint8_t expected = free_state;
+            if (slots_[i].state.compare_exchange_strong(expected, rendering_state,
+                                                        std::memory_order_acquire))
+                return frame_type{slots_[i].data, capacity_, std::uint8_t(i)};
+        }
+        return frame_type{};
+    }
+
+    /// Queues `frame` for transmission with `units` encoded units (at most
+    /// `frame.capacity`). Frames go out in submission order.
+    void submit(frame_type& frame, std::size_t units) noexcept
+    {
+        Slot& slot = slots_[frame.index];
+        slot.units = units + reset_units_;
+        encode_idle<Format>(reset_units_, frame.data + units);
+        slot.seq = next_seq_++;
+        slot.state.store(ready_state, std::memory_order_release);
+        frame = frame_type{};
+        kick();
+    }
+
+    /// Queues `units` units of externally owned, already padded symbols,
+    /// e.g. a mapped page of a pre-encoded show, without copying them. The
+    /// data must stay valid until the transfer completes. Takes one buffer
+    /// slot while queued; returns false if none is free.
+    bool submit_external(const unit_type* data, std::size_t units) noexcept
+    {
+        frame_type frame = acquire();
+        if (!frame)
+            return false;
+        Slot& slot = slots_[frame.index];
+        slot.wire = data;
+        slot.units = units;
+        slot.seq = next_seq_++;
+        slot.state.store(ready_state, std::memory_order_release);
+        kick();
+        return true;
+    }
+
+    /// Returns an acquired frame unsent.
+    void release(frame_type& frame) noexcept
+    {
+        slots_[frame.index].state.store(free_state, std::memory_order_release);
+        frame = frame_type{};
+    }
+
+    /// Backend completion callback: frees the buffer just sent and starts the
+    /// oldest queued one.
+    void on_transfer_complete() noexcept
+    {
+        if (sending_ < Buffers) {
+            slots_[sending_].wire = slots_[sending_].data;
+            slots_[sending_].state.store(free_state, std::memory_order_release);
+        }
+        sending_ = Buffers;
+        frames_sent_.fetch_add(1, std::memory_order_relaxed);
+        if (!start_next()) {
+            busy_.store(false, std::memory_order_release);
+            // A submit() between start_next() and the store saw the line busy.
+            kick();
+        }
+    }
+
+    /// on_transfer_complete() as a plain callback for backends and ISRs.
+    static void transfer_complete(void* engine) noexcept
+    {
+        static_cast<TransmitEngine*>(engine)->on_transfer_complete();
+    }
+
+    /// True while a transfer is in flight.
+    bool busy() const noexcept { return busy_.load(std::memory_order_acquire); }
+
+    std::uint32_t frames_sent() const noexcept
+    {
+        return frames_sent_.load(std::memory_order_relaxed);
+    }
+
+    /// Frames submitted and not yet sent, the one on the wire included.
+    std::size_t queued() const noexcept
+    {
+        std::size_t n = 0;
+        for (const Slot& s : slots_) {
+            const std::uint8_t state = s.state.load(std::memory_order_relaxed);
+            n += state == ready_state || state == sending_state;
+        }
+        return n;
+    }
+
+    std::size_t capacity() const noexcept { return capacity_; }
+    std::size_t reset_padding() const noexcept { return reset_units_; }
+
+    /// Sets the RET padding of frames submitted from now on, e.g. to a
+    /// calibrated gap. Buffers only have room for the gap given at
+    /// construction, so build the engine with the longest gap it may need
+    /// (ResetCalibration::max_ns when calibrating). Returns false, leaving
+    /// the padding unchanged, for a longer gap. Call from the submitting
+    /// thread.
+    bool set_reset_ns(std::uint32_t reset_ns) noexcept
+    {
+        const std::size_t units = reset_units<Format>(reset_ns);
+        if (units > max_reset_units_)
+            return false;
+        reset_units_ = units;
+        return true;
+    }
+
+    /// Longest RET padding set_reset_ns() accepts, in units.
+    std::size_t max_reset_padding() const noexcept { return max_reset_units_; }
+
+private:
+    static constexpr std::uint8_t free_state = 0;
+    static constexpr std::uint8_t rendering_state = 1;
+    static constexpr std::uint8_t ready_state = 2;
+    static constexpr std::uint8_t sending_state = 3;
+
+    TransmitEngine(Backend& backend, std::unique_ptr<Arena> arena, std::size_t pixels,
+                   std::uint32_t reset_ns)
+        : TransmitEngine(backend, *arena, pixels, reset_ns, default_alignment)
+    {
+        heap_ = std::move(arena);
+    }
+
+    struct Slot {
+        unit_type* data = nullptr;
+        const unit_type* wire = nullptr; ///< what goes out: `data` or external
+        std::size_t units = 0;
+        std::uint32_t seq = 0;
+        std::atomic<std::uint8_t> state{free_state};
+    };
+
+    std::size_t stride() const noexcept { return capacity_ + max_reset_units_; }
+
+    void kick() noexcept
+    {
+        bool idle = false;
+        if (busy_.compare_exchange_strong(idle, true, std::memory_order_acq_rel) && !start_next())
+            busy_.store(false, std::memory_order_release);
+    }
+
+    /// Starts the oldest ready buffer; only called by the owner of `busy_`.
+    bool start_next() noexcept
+    {
+        std::size_t best = Buffers;
+        for (std::size_t i = 0; i < Buffers; ++i) {
+            if (slots_[i].state.load(std::memory_order_acquire) != ready_state)
+                continue;
+            if (best == Buffers || std::int32_t(slots_[i].seq - slots_[best].seq) < 0)
+                best = i;
+        }
+        if (best == Buffers)
+            return false;
+        slots_[best].state.store(sending_state, std::memory_order_relaxed);
+        sending_ = best;
+        backend_.start(slots_[best].wire, slots_[best].units);
+        return true;
+    }
+
+    Backend& backend_;
+    const std::size_t capacity_;
+    const std::size_t max_reset_units_;
+    std::size_t reset_units_;
+    std::unique_ptr<Arena> heap_;
+    Slot slots_[Buffers];
+    std::size_t sending_ = Buffers;
+    std::uint32_t next_seq_ = 0;
+    std::atomic<bool> busy_{false};
+    std::atomic<std::uint32_t> frames_sent_{0};
+};
+
+} // namespace ws2812b
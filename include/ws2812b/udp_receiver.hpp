@@ -0,0 +1,140 @@
+// Batched UDP receive for net_ingest.hpp (POSIX sockets).
+//
+// On Linux one recvmmsg() call drains up to `Batch` datagrams into fixed
+// slots, so the per-packet cost is parsing plus the one copy into the
+// frame; elsewhere (BSD sockets, lwIP) the same interface falls back to a
+// non-blocking recvfrom() loop.
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ws2812b {
+
+template <std::size_t Batch = 32>
+class UdpReceiver {
+public:
+    /// Fits an E1.31 (638), Art-Net (530) or full DDP (1450) datagram.
+    static constexpr std::size_t slot_bytes = 1472;
+
+    UdpReceiver() = default;
+    UdpReceiver(const UdpReceiver&) = delete;
+    UdpReceiver& operator=(const UdpReceiver&) = delete;
+    ~UdpReceiver() { close(); }
+
+    /// Binds to `port` on all interfaces. `rcvbuf` sizes the kernel socket
+    /// buffer, which has to absorb a whole frame's burst of universes.
+    bool open(std::uint16_t port, int rcvbuf = 4 << 20)
+    {
+        close();
+        fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0)
+            return false;
+        int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) {
+            close();
+            return false;
+        }
+        slots_.reset(new std::uint8_t[Batch * slot_bytes]);
+        return true;
+    }
+
+    /// Joins the E1.31 multicast group 239.255.<hi>.<lo> of `universe`.
+    bool join_e131(std::uint16_t universe, std::uint32_t interface_addr = INADDR_ANY) noexcept
+    {
+        ip_mreq req{};
+        req.imr_multiaddr.s_addr = htonl(0xEFFF0000u | universe);
+        req.imr_interface.s_addr = htonl(interface_addr);
+        return ::setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &req, sizeof req) == 0;
+    }
+
+    void close() noexcept
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+    int fd() const noexcept { return fd_; }
+
+    /// Waits up to `timeout_ms` (-1 = forever) for traffic, then passes
+    /// every queued datagram to `fn(const std::uint8_t*, std::size_t)`, at
+    /// most Batch per system call. The pointer is valid during the call
+    /// only. Returns the number of datagrams, or -1 on a socket error.
+    template <typename Fn>
+    int receive(Fn&& fn, int timeout_ms = -1)
+    {
+        pollfd pfd{fd_, POLLIN, 0};
+        const int ready = ::poll(&pfd, 1, timeout_ms);
+        if (ready <= 0)
+            return ready;
+        int total = 0;
+        for (;;) {
+            const int n = read_batch();
+            if (n < 0)
+                return total ? total : -1;
+            for (int i = 0; i < n; ++i)
+                fn(slots_.get() + std::size_t(i) * slot_bytes, lengths_[i]);
+            total += n;
+            if (std::size_t(n) < Batch)
+                return total;
+        }
+    }
+
+private:
+#if defined(__linux__)
+    int read_batch() noexcept
+    {
+        mmsghdr msgs[Batch];
+        iovec iov[Batch];
+        for (std::size_t i = 0; i < Batch; ++i) {
+            iov[i] = iovec{slots_.get() + i * slot_bytes, slot_bytes};
+            msgs[i] = mmsghdr{};
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        const int n = ::recvmmsg(fd_, msgs, Batch, MSG_DONTWAIT, nullptr);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        for (int i = 0; i < n; ++i)
+            lengths_[i] = msgs[i].msg_len;
+        return n;
+    }
+#else
+    int read_batch() noexcept
+    {
+        std::size_t n = 0;
+        for (; n < Batch; ++n) {
+            const ssize_t len = ::recvfrom(fd_, slots_.get() + n * slot_bytes, slot_bytes,
+                                           MSG_DONTWAIT, nullptr, nullptr);
+            if (len < 0) {
+                if (n == 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                    return -1;
+                break;
+            }
+            lengths_[n] = std::size_t(len);
+        }
+        return int(n);
+    }
+#endif
+
+    int fd_ = -1;
+    std::unique_ptr<std::uint8_t[]> slots_;
+    std::size_t lengths_[Batch] = {};
+};
+
+} // namespace ws2812b
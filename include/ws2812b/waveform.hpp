@@ -0,0 +1,137 @@
+// Reconstruction of the line waveform a peripheral produces from symbols.
+//
+// Waveforms are handled as runs: the line holds `level` for `ps`
+// picoseconds. Runs come either from symbol buffers (what an ideal
+// peripheral clocks out) or from edge captures of a logic analyzer or a
+// capture timer on a loopback input.
+#pragma once
+
+#include "parallel_output.hpp"
+#include "symbol_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace ws2812b {
+
+/// The line changes to `level` at time `t_ps`.
+struct Edge {
+    std::uint64_t t_ps;
+    bool level;
+};
+
+namespace detail {
+
+/// Merges equal consecutive levels and forwards finished runs to `sink`.
+template <typename Sink>
+class RunBuilder {
+public:
+    explicit RunBuilder(Sink& sink) : sink_(sink) {}
+
+    /// Line is at `level` from `t_ps` on.
+    void at(std::uint64_t t_ps, bool level)
+    {
+        if (started_ && level == level_)
+            return;
+        if (started_ && t_ps > since_)
+            sink_(level_, t_ps - since_);
+        started_ = true;
+        level_ = level;
+        since_ = t_ps;
+    }
+
+    void finish(std::uint64_t t_ps)
+    {
+        if (started_ && t_ps > since_)
+            sink_(level_, t_ps - since_);
+        started_ = false;
+    }
+
+private:
+    Sink& sink_;
+    bool started_ = false;
+    bool level_ = false;
+    std::uint64_t since_ = 0;
+};
+
+/// `ticks` of a `hz` clock in ps, without overflowing on long frames.
+constexpr std::uint64_t ticks_to_ps(std::uint64_t ticks, std::uint64_t hz) noexcept
+{
+    constexpr std::uint64_t ps_per_s = 1'000'000'000'000ull;
+    const std::uint64_t rem = ticks % hz;
+    return ticks / hz * ps_per_s + rem * (ps_per_s / hz) + rem * (ps_per_s % hz) / hz;
+}
+
+} // namespace detail
+
+/// Feeds `sink(bool level, std::uint64_t ps)` with the runs an ideal
+/// peripheral produces for `n` units of `Format`. `channel` selects the
+/// port bit of a ParallelWords stream and is ignored otherwise. Returns
+/// the total duration in picoseconds.
+template <typename Format, typename Sink>
+std::uint64_t render_waveform(const typename Format::unit_type* units, std::size_t n,
+                              Sink&& sink, unsigned channel = 0)
+{
+    detail::RunBuilder<std::remove_reference_t<Sink>> runs(sink);
+    using detail::ticks_to_ps;
+    std::uint64_t end = 0;
+
+    if constexpr (detail::is_spi_format<Format>::value) {
+        const std::uint64_t bits = std::uint64_t(n) * 8;
+        for (std::uint64_t b = 0; b < bits; ++b)
+            runs.at(ticks_to_ps(b, Format::spi_clock_hz), (units[b / 8] >> (7 - b % 8)) & 1u);
+        end = ticks_to_ps(bits, Format::spi_clock_hz);
+    } else if constexpr (detail::is_pwm_format<Format>::value) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint64_t start = std::uint64_t(i) * Format::period_ticks;
+            runs.at(ticks_to_ps(start, Format::timer_hz), units[i] != 0);
+            runs.at(ticks_to_ps(start + units[i], Format::timer_hz), false);
+        }
+        end = ticks_to_ps(std::uint64_t(n) * Format::period_ticks, Format::timer_hz);
+    } else if constexpr (detail::is_rmt_format<Format>::value) {
+        std::uint64_t ticks = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint32_t item = units[i];
+            runs.at(ticks_to_ps(ticks, Format::rmt_tick_hz), (item >> 15) & 1u);
+            ticks += item & 0x7FFFu;
+            runs.at(ticks_to_ps(ticks, Format::rmt_tick_hz), (item >> 31) & 1u);
+            ticks += (item >> 16) & 0x7FFFu;
+        }
+        end = ticks_to_ps(ticks, Format::rmt_tick_hz);
+    } else if constexpr (detail::is_raw_format<Format>::value) {
+        const std::uint64_t bits = std::uint64_t(n) * 8;
+        std::uint64_t cycles = 0;
+        for (std::uint64_t b = 0; b < bits; ++b) {
+            const bool one = (units[b / 8] >> (7 - b % 8)) & 1u;
+            runs.at(ticks_to_ps(cycles, Format::sm_clock_hz), true);
+            runs.at(ticks_to_ps(cycles + (one ? Format::one_high_cycles : Format::zero_high_cycles),
+                                Format::sm_clock_hz),
+                    false);
+            cycles += Format::cycles_per_bit;
+        }
+        end = ticks_to_ps(cycles, Format::sm_clock_hz);
+    } else {
+        static_assert(detail::is_parallel_format<Format>::value, "unknown symbol format");
+        for (std::size_t i = 0; i < n; ++i)
+            runs.at(ticks_to_ps(i, Format::slot_hz), (units[i] >> channel) & 1u);
+        end = ticks_to_ps(n, Format::slot_hz);
+    }
+    runs.finish(end);
+    return end;
+}
+
+/// Feeds `sink` with the runs between consecutive captured edges. The last
+/// edge has no known end and is reported as lasting `tail_ps`.
+template <typename Sink>
+void edges_to_runs(const Edge* edges, std::size_t n, Sink&& sink, std::uint64_t tail_ps = 0)
+{
+    detail::RunBuilder<std::remove_reference_t<Sink>> runs(sink);
+    for (std::size_t i = 0; i < n; ++i)
+        runs.at(edges[i].t_ps, edges[i].level);
+    if (n != 0)
+        runs.finish(edges[n - 1].t_ps + tail_ps);
+}
+
+} // namespace ws2812b
@@ -0,0 +1,253 @@
+// Coroutine scheduler for many independently paced output zones (C++20).
+//
+// Each zone is a coroutine that loops on `co_await sched.slot(governor)`
+// and renders and submits a frame whenever its governor's slot opens. One
+// thread drives every zone by calling poll(now) and sleeping for
+// wait_ns(now), with no thread per zone. Timed waits sit in a deadline
+// heap. Waits on a condition, such as a free engine buffer, are rechecked
+// on every poll(), so call it again after a transfer completes. A zone's
+// coroutine frame is allocated once at spawn(); waiting and resuming
+// allocate nothing.
+//
+// Only available when the compiler implements coroutines
+// (__cpp_impl_coroutine); otherwise this header declares nothing.
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include "governor.hpp"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace ws2812b {
+
+/// The coroutine type of a zone body. Hand it to ZoneScheduler::spawn().
+class ZoneTask {
+public:
+    struct promise_type {
+        ZoneTask get_return_object() noexcept
+        {
+            return ZoneTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    ZoneTask(ZoneTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    ZoneTask(const ZoneTask&) = delete;
+    ZoneTask& operator=(const ZoneTask&) = delete;
+    ~ZoneTask()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+private:
+    friend class ZoneScheduler;
+    explicit ZoneTask(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+class ZoneScheduler {
+public:
+    /// Reserves room for `zones` zones, so steady-state scheduling does
+    /// not allocate.
+    explicit ZoneScheduler(std::size_t zones = 64)
+    {
+        tasks_.reserve(zones);
+        timers_.reserve(zones);
+        waiting_.reserve(zones);
+        due_.reserve(zones);
+        running_.reserve(zones);
+    }
+
+    ZoneScheduler(const ZoneScheduler&) = delete;
+    ZoneScheduler& operator=(const ZoneScheduler&) = delete;
+
+    ~ZoneScheduler()
+    {
+        for (auto h : tasks_)
+            h.destroy();
+    }
+
+    /// Takes ownership of a zone; it first runs in the next poll().
+    void spawn(ZoneTask task)
+    {
+        auto h = std::exchange(task.handle_, {});
+        tasks_.push_back(h);
+        due_.push_back(h);
+    }
+
+    /// Runs every zone whose wait is over at `now`. Returns the number of
+    /// resumptions.
+    std::size_t poll(std::uint64_t now)
+    {
+        now_ = now;
+        std::size_t resumed = 0;
+        // Zones that became due (spawned, or a condition came true) first,
+        // then timers in deadline order. Whatever they wait on next is
+        // queued for a later pass, not this one.
+        for (std::size_t i = 0; i < waiting_.size();) {
+            if (waiting_[i].ready(waiting_[i].ctx)) {
+                due_.push_back(waiting_[i].handle);
+                waiting_[i] = waiting_.back();
+                waiting_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        running_.swap(due_);
+        for (auto h : running_) {
+            h.resume();
+            ++resumed;
+        }
+        running_.clear();
+        while (!timers_.empty() && timers_.front().deadline <= now) {
+            std::pop_heap(timers_.begin(), timers_.end(), later);
+            const auto h = timers_.back().handle;
+            timers_.pop_back();
+            h.resume();
+            ++resumed;
+        }
+        reap();
+        return resumed;
+    }
+
+    /// Time from `now` until the earliest timed wait ends; 0 if a zone is
+    /// due already, and ~0 if no zone has a timed wait.
+    std::uint64_t wait_ns(std::uint64_t now) const noexcept
+    {
+        if (!due_.empty())
+            return 0;
+        if (timers_.empty())
+            return ~std::uint64_t(0);
+        const std::uint64_t t = timers_.front().deadline;
+        return t > now ? t - now : 0;
+    }
+
+    /// Time of the current poll().
+    std::uint64_t now() const noexcept { return now_; }
+    /// Zones not yet finished.
+    std::size_t zones() const noexcept { return tasks_.size(); }
+
+    /// `co_await slot(governor)` resumes once `governor` grants a frame
+    /// slot, and yields the time it was granted. The slot is taken.
+    auto slot(FrameGovernor& governor) noexcept
+    {
+        struct Awaiter {
+            ZoneScheduler& s;
+            FrameGovernor& g;
+            bool taken = false;
+            bool await_ready() noexcept { return taken = g.poll(s.now_); }
+            void await_suspend(std::coroutine_handle<> h) { s.at(g.next_slot(), h); }
+            std::uint64_t await_resume() noexcept
+            {
+                if (!taken) // resumed by the timer at or after the slot
+                    g.poll(s.now_);
+                return s.now_;
+            }
+        };
+        return Awaiter{*this, governor};
+    }
+
+    /// `co_await sleep_until(t)` resumes at the first poll() at or after `t`.
+    auto sleep_until(std::uint64_t t) noexcept
+    {
+        struct Awaiter {
+            ZoneScheduler& s;
+            std::uint64_t t;
+            bool await_ready() const noexcept { return t <= s.now_; }
+            void await_suspend(std::coroutine_handle<> h) { s.at(t, h); }
+            std::uint64_t await_resume() const noexcept { return s.now_; }
+        };
+        return Awaiter{*this, t};
+    }
+
+    /// `co_await acquire(engine)` resumes with a free buffer of a
+    /// TransmitEngine (anything whose acquire() returns a frame that tests
+    /// false when none is free).
+    template <typename Engine>
+    auto acquire(Engine& engine) noexcept
+    {
+        using frame_type = decltype(engine.acquire());
+        struct Awaiter {
+            ZoneScheduler& s;
+            Engine& e;
+            frame_type frame{};
+            bool await_ready() noexcept { return bool(frame = e.acquire()); }
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                s.when(h, this, [](void* self) {
+                    auto* a = static_cast<Awaiter*>(self);
+                    return bool(a->frame = a->e.acquire());
+                });
+            }
+            frame_type await_resume() noexcept { return frame; }
+        };
+        return Awaiter{*this, engine};
+    }
+
+private:
+    struct Timer {
+        std::uint64_t deadline;
+        std::uint64_t seq;
+        std::coroutine_handle<> handle;
+    };
+
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        void* ctx;
+        bool (*ready)(void*);
+    };
+
+    /// Heap order: earliest deadline on top, ties in arrival order.
+    static bool later(const Timer& a, const Timer& b) noexcept
+    {
+        return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+    }
+
+    void at(std::uint64_t deadline, std::coroutine_handle<> h)
+    {
+        timers_.push_back(Timer{deadline, seq_++, h});
+        std::push_heap(timers_.begin(), timers_.end(), later);
+    }
+
+    void when(std::coroutine_handle<> h, void* ctx, bool (*ready)(void*))
+    {
+        waiting_.push_back(Waiter{h, ctx, ready});
+    }
+
+    /// Frees zones whose body returned.
+    void reap() noexcept
+    {
+        for (std::size_t i = 0; i < tasks_.size();) {
+            if (tasks_[i].done()) {
+                tasks_[i].destroy();
+                tasks_[i] = tasks_.back();
+                tasks_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    std::vector<std::coroutine_handle<ZoneTask::promise_type>> tasks_;
+    std::vector<Timer> timers_;
+    std::vector<Waiter> waiting_;
+    std::vector<std::coroutine_handle<>> due_;
+    std::vector<std::coroutine_handle<>> running_;
+    std::uint64_t now_ = 0;
+    std::uint64_t seq_ = 0;
+};
+
+} // namespace ws2812b
+
+#endif // __cpp_impl_coroutine